@@ -0,0 +1,119 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__ARITHMETIC_H
+#define PASCAL_COMPILER_TUTORIAL__ARITHMETIC_H
+
+#include <cassert>
+#include "memory.h"
+#include "token.h"
+#include "interpreter_error.h"
+
+namespace freezing::interpreter::detail {
+
+// Typed arithmetic kernels shared by the tree-walking interpreter, the virtual machine and the ConstantFolder, so that
+// both execution modes and the folded constants produce identical results. Operand types are known statically (see
+// SemanticModel::expression_types), so the kernels never inspect which alternative a DataType holds.
+
+// Unwraps a value that is statically known to be INTEGER.
+inline int as_integer(const DataType& value) {
+  const int* integer = std::get_if<int>(&value);
+  assert(integer != nullptr && "Type checking guarantees that the value is INTEGER.");
+  return *integer;
+}
+
+// Unwraps a value that is statically known to be REAL.
+inline double as_real(const DataType& value) {
+  const double* real = std::get_if<double>(&value);
+  assert(real != nullptr && "Type checking guarantees that the value is REAL.");
+  return *real;
+}
+
+// The only error of the arithmetic, it's empty so that the kernels' Results are as small as their values.
+struct DivisionByZero {};
+
+inline InterpreterError division_by_zero_error() {
+  return InterpreterError{"Invalid division by zero"};
+}
+
+// Used for both DIV (int) and / (double).
+template<typename T>
+Result<T, DivisionByZero> divide(T lhs, T rhs) {
+  if (rhs != 0) {
+    return lhs / rhs;
+  }
+  return make_error(DivisionByZero{});
+}
+
+// T is either int or double, as determined by the type of the BinOp node. ConstantFolder also evaluates INTEGER
+// operations as int64_t, to find the results that overflow.
+template<typename T>
+Result<T, DivisionByZero> Calculate(T left, TokenType token_type, T right) {
+  switch (token_type) {
+  case TokenType::MINUS:
+    return left - right;
+  case TokenType::PLUS:
+    return left + right;
+  case TokenType::MUL:
+    return left * right;
+  case TokenType::INTEGER_DIV:
+  case TokenType::REAL_DIV:
+    return divide(left, right);
+  case TokenType::OPEN_BRACKET:
+  case TokenType::CLOSED_BRACKET:
+  case TokenType::END_OF_FILE:
+  case TokenType::INTEGER:
+  case TokenType::DOT:
+  case TokenType::BEGIN:
+  case TokenType::END:
+  case TokenType::ASSIGN:
+  case TokenType::SEMICOLON:
+  case TokenType::ID:
+  case TokenType::INTEGER_CONST:
+  case TokenType::REAL_CONST:
+  case TokenType::COLON:
+  case TokenType::PROGRAM:
+  case TokenType::VAR:
+  case TokenType::REAL:
+  case TokenType::COMMA:
+  case TokenType::PROCEDURE:
+    break;
+  }
+  assert(false);
+  return T{};
+}
+
+template<typename T>
+T UnaryCalculate(T result, TokenType token_type) {
+  switch (token_type) {
+  case TokenType::MINUS:
+    return -result;
+  case TokenType::PLUS:
+    return result;
+  case TokenType::END_OF_FILE:
+  case TokenType::INTEGER:
+  case TokenType::MUL:
+  case TokenType::INTEGER_DIV:
+  case TokenType::OPEN_BRACKET:
+  case TokenType::CLOSED_BRACKET:
+  case TokenType::DOT:
+  case TokenType::BEGIN:
+  case TokenType::END:
+  case TokenType::ASSIGN:
+  case TokenType::SEMICOLON:
+  case TokenType::ID:
+  case TokenType::INTEGER_CONST:
+  case TokenType::REAL_CONST:
+  case TokenType::COLON:
+  case TokenType::PROGRAM:
+  case TokenType::VAR:
+  case TokenType::REAL:
+  case TokenType::REAL_DIV:
+  case TokenType::COMMA:
+  case TokenType::PROCEDURE:
+    break;
+  }
+  assert(false);
+  return -1;
+}
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__ARITHMETIC_H
@@ -5,8 +5,12 @@
 #ifndef PASCAL_COMPILER_TUTORIAL__AST_H
 #define PASCAL_COMPILER_TUTORIAL__AST_H
 
+#include <memory>
 #include <variant>
 #include "token.h"
+#include "identifier.h"
+#include "ast_arena.h"
+#include "lazy_block.h"
 
 namespace freezing::interpreter {
 
@@ -24,7 +28,6 @@ struct ProcedureDecl;
 struct ProcedureCall;
 
 // Includes expression, factor and term nodes.
-using Identifier = std::string;
 using NumType = std::variant<int, double>;
 using ExpressionNode = std::variant<BinOp, UnaryOp, Variable, Num>;
 using Statement = std::variant<ProcedureCall, CompoundStatement, AssignmentStatement, Empty>;
@@ -48,15 +51,15 @@ struct UnaryOp {
   // Either PLUS or MINUS.
   TokenType op_type;
   // TODO: Rename to expression.
-  std::unique_ptr<ExpressionNode> node;
+  const ExpressionNode* node;
 };
 
 struct BinOp {
   // Either PLUS, MINUS, MUL, INTEGER_DIV, REAL_DIV.
   NodeId id;
   TokenType op_type;
-  std::unique_ptr<ExpressionNode> left;
-  std::unique_ptr<ExpressionNode> right;
+  const ExpressionNode* left;
+  const ExpressionNode* right;
 };
 
 struct AssignmentStatement {
@@ -93,14 +96,14 @@ struct Block {
 
 struct ProcedureDecl {
   NodeId id;
-  std::string name;
+  Identifier name;
   std::vector<Param> parameters;
-  std::shared_ptr<Block> block;
+  const LazyBlock* block;
 };
 
 struct ProcedureCall {
   NodeId id;
-  std::string name;
+  Identifier name;
   std::vector<ExpressionNode> parameters;
 };
 
@@ -108,6 +111,10 @@ struct Program {
   NodeId id;
   Identifier name;
   Block block;
+  // Owns all the nodes that are referenced through pointers, e.g. operands and procedure blocks.
+  AstArena arena;
+  // Parses the procedure blocks that were skipped, and owns their nodes. Null unless they're parsed lazily.
+  std::shared_ptr<DeferredParser> deferred_parser;
 };
 
 }
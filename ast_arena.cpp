@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include "ast_arena.h"
+
+namespace freezing::interpreter {
+
+AstArena::AstArena(AstArena&& other) noexcept
+    : blocks_{std::move(other.blocks_)},
+      current_{std::exchange(other.current_, nullptr)},
+      end_{std::exchange(other.end_, nullptr)},
+      destructors_{std::move(other.destructors_)} {
+  other.blocks_.clear();
+  other.destructors_.clear();
+}
+
+AstArena& AstArena::operator=(AstArena&& other) noexcept {
+  if (this != &other) {
+    clear();
+    blocks_ = std::move(other.blocks_);
+    current_ = std::exchange(other.current_, nullptr);
+    end_ = std::exchange(other.end_, nullptr);
+    destructors_ = std::move(other.destructors_);
+    other.blocks_.clear();
+    other.destructors_.clear();
+  }
+  return *this;
+}
+
+AstArena::~AstArena() {
+  clear();
+}
+
+void AstArena::adopt(AstArena&& other) {
+  // Only the remainder of the other's current block is lost, nodes are still allocated from this arena's block.
+  blocks_.insert(blocks_.end(), std::make_move_iterator(other.blocks_.begin()),
+                 std::make_move_iterator(other.blocks_.end()));
+  destructors_.insert(destructors_.end(), other.destructors_.begin(), other.destructors_.end());
+  other.blocks_.clear();
+  other.destructors_.clear();
+  other.current_ = nullptr;
+  other.end_ = nullptr;
+}
+
+void* AstArena::allocate(std::size_t size, std::size_t alignment) {
+  auto address = reinterpret_cast<std::uintptr_t>(current_);
+  auto aligned = (address + alignment - 1) & ~(alignment - 1);
+  if (current_ == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(end_)) {
+    // Nodes are tiny, but the block is still sized to fit whatever is requested.
+    std::size_t block_size = std::max(kBlockSize, size + alignment);
+    blocks_.emplace_back(new std::byte[block_size]);
+    current_ = blocks_.back().get();
+    end_ = current_ + block_size;
+    address = reinterpret_cast<std::uintptr_t>(current_);
+    aligned = (address + alignment - 1) & ~(alignment - 1);
+  }
+  current_ += (aligned - address) + size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+void AstArena::clear() {
+  // Children are referenced by plain pointers, so destroying a node never recurses into the others.
+  for (auto& destructor : destructors_) {
+    destructor.destroy(destructor.object);
+  }
+  destructors_.clear();
+  blocks_.clear();
+  current_ = nullptr;
+  end_ = nullptr;
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__AST_ARENA_H
+#define PASCAL_COMPILER_TUTORIAL__AST_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace freezing::interpreter {
+
+// Owns the nodes of a single AST. Nodes are bump allocated from large blocks and they are all freed at once when
+// the arena is destroyed, so there's no per node malloc/free and no recursive teardown.
+// Nodes never move, so pointers returned by create() remain valid for as long as the arena exists, even if it's moved.
+class AstArena {
+public:
+  AstArena() = default;
+  AstArena(const AstArena&) = delete;
+  AstArena& operator=(const AstArena&) = delete;
+  AstArena(AstArena&& other) noexcept;
+  AstArena& operator=(AstArena&& other) noexcept;
+  ~AstArena();
+
+  template<typename T, typename... Args>
+  T* create(Args&& ... args) {
+    T* node = new(allocate(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors_.push_back(Destructor{node, [](void* object) { static_cast<T*>(object)->~T(); }});
+    }
+    return node;
+  }
+
+  // Takes over the nodes of the other arena, e.g. one filled by another thread, which leaves it empty.
+  void adopt(AstArena&& other);
+
+private:
+  static constexpr std::size_t kBlockSize = 64 * 1024;
+
+  // Only nodes that aren't trivially destructible are destroyed, e.g. blocks, whose statements and declarations are in
+  // vectors, and lazy blocks, which keep their parse error. Identifiers are interned, so they own no memory.
+  struct Destructor {
+    void* object;
+    void (* destroy)(void*);
+  };
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::byte* current_ = nullptr;
+  std::byte* end_ = nullptr;
+  std::vector<Destructor> destructors_;
+
+  void* allocate(std::size_t size, std::size_t alignment);
+  void clear();
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__AST_ARENA_H
@@ -4,6 +4,7 @@
 
 #include "ast.h"
 #include "ast_visitor.h"
+#include "flat_ast.h"
 
 #ifndef PASCAL_COMPILER_TUTORIAL__AST_DOT_VISUALISER_H
 #define PASCAL_COMPILER_TUTORIAL__AST_DOT_VISUALISER_H
@@ -34,78 +35,63 @@ public:
   explicit AstDotVisualiser() {}
 
   std::string generate(const Program& program) {
+    return generate(FlatAst::create(program));
+  }
+
+  std::string generate(const FlatAst& ast) {
     std::string body{};
 
-    AstVisitorCallbacks callbacks{};
+    // Edges to the children are generated in the same order as the children appear in the Program.
+    auto add_node = [&body, &ast](NodeId node_id, const std::string& label) {
+      body += detail::format_node(node_id, label);
+      for (auto it = ast.children_begin(node_id); it != ast.children_end(node_id); ++it) {
+        body += detail::format_node_edge(node_id, *it);
+      }
+    };
+
+    FlatAstVisitorCallbacks callbacks{};
 
-    callbacks.program_post = [&body](const Program& program) {
-      body += detail::format_node(program.id, fmt::format("Program({})", program.name));
-      body += detail::format_node_edge(program.id, program.block.id);
+    callbacks.program_post = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("Program({})", ast.name(node_id)));
     };
-    callbacks.block = [&body](const Block& block) {
-      body += detail::format_node(block.id, fmt::format("Block"));
-      for (const auto& decl : block.variable_declarations) {
-        body += detail::format_node_edge(block.id, decl.id);
-      }
-      for (const auto& proc_decl : block.procedure_declarations) {
-        body += detail::format_node_edge(block.id, proc_decl.id);
-      }
-      body += detail::format_node_edge(block.id, block.compound_statement.id);
+    callbacks.block = [&add_node](NodeId node_id) {
+      add_node(node_id, "Block");
     };
-    callbacks.var_decl_post = [&body](const VarDecl& var_decl) {
-      body += detail::format_node(var_decl.id, fmt::format("VarDecl(type={})", var_decl.type_specification));
-      for (const auto& variable : var_decl.variables) {
-        body += detail::format_node_edge(var_decl.id, variable.id);
-      }
+    callbacks.var_decl_post = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("VarDecl(type={})", ast.token_type(node_id)));
     };
-    callbacks.procedure_decl_post = [&body](const ProcedureDecl& procedure_decl) {
-      body += detail::format_node(procedure_decl.id, fmt::format("ProcedureDecl({})", procedure_decl.name));
-      for (const auto& param : procedure_decl.parameters) {
-        body += detail::format_node_edge(procedure_decl.id, param.id);
-      }
-      body += detail::format_node_edge(procedure_decl.id, procedure_decl.block->id);
+    callbacks.procedure_decl_post = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("ProcedureDecl({})", ast.name(node_id)));
     };
-    callbacks.param = [&body](const Param& param) {
-      body += detail::format_node(param.id, fmt::format("Param({}: {})", param.identifier, param.type_specification));
+    callbacks.param = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("Param({}: {})", ast.name(node_id), ast.token_type(node_id)));
     };
-    callbacks.compound_statement = [&body](const CompoundStatement& compound_statement) {
-      body += detail::format_node(compound_statement.id, "CompoundStatement");
-      for (const auto& statement : compound_statement.statements) {
-        body += detail::format_node_edge(compound_statement.id, std::visit(NodeIdExtractorFn{}, statement));
-      }
+    callbacks.compound_statement = [&add_node](NodeId node_id) {
+      add_node(node_id, "CompoundStatement");
     };
-    callbacks.assignment_statement = [&body](const AssignmentStatement& assignment_statement) {
-      body += detail::format_node(assignment_statement.id, ":=");
-      body += detail::format_node_edge(assignment_statement.id, assignment_statement.variable.id);
-      body += detail::format_node_edge(assignment_statement.id,
-                                       std::visit(NodeIdExtractorFn{}, assignment_statement.expression));
+    callbacks.assignment_statement = [&add_node](NodeId node_id) {
+      add_node(node_id, ":=");
     };
-    callbacks.procedure_call_post = [&body](const ProcedureCall& procedure_call) {
-      body += detail::format_node(procedure_call.id, fmt::format("{}()", procedure_call.name));
-      for (const auto& param : procedure_call.parameters) {
-        body += detail::format_node_edge(procedure_call.id, std::visit(NodeIdExtractorFn{}, param));
-      }
+    callbacks.procedure_call_post = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("{}()", ast.name(node_id)));
     };
-    callbacks.unary_op = [&body](const UnaryOp& unary_op) {
-      body += detail::format_node(unary_op.id, fmt::format("Unary({})", unary_op.op_type));
-      body += detail::format_node_edge(unary_op.id, std::visit(NodeIdExtractorFn{}, *unary_op.node));
+    callbacks.unary_op = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("Unary({})", ast.token_type(node_id)));
     };
-    callbacks.bin_op = [&body](const BinOp& bin_op) {
-      body += detail::format_node(bin_op.id, fmt::format("Binary({})", bin_op.op_type));
-      body += detail::format_node_edge(bin_op.id, std::visit(NodeIdExtractorFn{}, *bin_op.left));
-      body += detail::format_node_edge(bin_op.id, std::visit(NodeIdExtractorFn{}, *bin_op.right));
+    callbacks.bin_op = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("Binary({})", ast.token_type(node_id)));
     };
-    callbacks.variable = [&body](const Variable& variable) {
-      body += detail::format_node(variable.id, fmt::format("Variable({})", variable.name));
+    callbacks.variable = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("Variable({})", ast.name(node_id)));
     };
-    callbacks.num = [&body](const Num& num) {
-      body += detail::format_node(num.id, fmt::format("Num({})", num.value));
+    callbacks.num = [&ast, &add_node](NodeId node_id) {
+      add_node(node_id, fmt::format("Num({})", ast.value(node_id)));
     };
-    callbacks.empty = [&body](const Empty& empty) {
-      body += detail::format_node(empty.id, "Empty");
+    callbacks.empty = [&add_node](NodeId node_id) {
+      add_node(node_id, "Empty");
     };
 
-    AstVisitorFn{callbacks}.visit(program);
+    FlatAstVisitorFn{callbacks}.visit(ast);
 
     const std::string header =
         R"(digraph astgraph {
@@ -0,0 +1,107 @@
+#include <vector>
+#include "ast_relabel.h"
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+// The AST only hands out const pointers to the nodes, but the nodes themselves were created mutable by the arena.
+template<typename T>
+T& mutable_node(const T* node) {
+  return *const_cast<T*>(node);
+}
+
+class NodeIdShifter {
+public:
+  explicit NodeIdShifter(NodeId offset) : offset_{offset} {}
+
+  void shift(ProcedureDecl& procedure_declaration) {
+    procedure_declaration.id += offset_;
+    for (auto& param : procedure_declaration.parameters) {
+      param.id += offset_;
+    }
+    // Lazily parsed blocks are numbered only once they're parsed, after all the other nodes.
+    if (const Block* block = procedure_declaration.block->parsed()) {
+      shift(mutable_node(block));
+    }
+  }
+
+  void shift(Block& block) {
+    block.id += offset_;
+    for (auto& variable_declaration : block.variable_declarations) {
+      variable_declaration.id += offset_;
+      for (auto& variable : variable_declaration.variables) {
+        variable.id += offset_;
+      }
+    }
+    for (auto& procedure_declaration : block.procedure_declarations) {
+      shift(procedure_declaration);
+    }
+    shift(block.compound_statement);
+  }
+
+  void shift(CompoundStatement& compound_statement) {
+    compound_statement.id += offset_;
+    for (auto& statement : compound_statement.statements) {
+      std::visit([this](auto& node) { shift(node); }, statement);
+    }
+  }
+
+  void shift(ProcedureCall& procedure_call) {
+    procedure_call.id += offset_;
+    for (auto& parameter : procedure_call.parameters) {
+      shift(parameter);
+    }
+  }
+
+  void shift(AssignmentStatement& assignment_statement) {
+    assignment_statement.id += offset_;
+    assignment_statement.variable.id += offset_;
+    shift(assignment_statement.expression);
+  }
+
+  void shift(Empty& empty) {
+    empty.id += offset_;
+  }
+
+  // Expressions can be nested far deeper than statements, so they're walked with an explicit stack.
+  void shift(ExpressionNode& expression_node) {
+    expressions_.push_back(&expression_node);
+    while (!expressions_.empty()) {
+      ExpressionNode* current = expressions_.back();
+      expressions_.pop_back();
+      std::visit([this](auto& node) { shift_expression(node); }, *current);
+    }
+  }
+
+private:
+  NodeId offset_;
+  std::vector<ExpressionNode*> expressions_;
+
+  void shift_expression(BinOp& bin_op) {
+    bin_op.id += offset_;
+    expressions_.push_back(&mutable_node(bin_op.left));
+    expressions_.push_back(&mutable_node(bin_op.right));
+  }
+
+  void shift_expression(UnaryOp& unary_op) {
+    unary_op.id += offset_;
+    expressions_.push_back(&mutable_node(unary_op.node));
+  }
+
+  void shift_expression(Variable& variable) {
+    variable.id += offset_;
+  }
+
+  void shift_expression(Num& num) {
+    num.id += offset_;
+  }
+};
+
+}
+
+void shift_node_ids(ProcedureDecl& procedure_declaration, NodeId offset) {
+  detail::NodeIdShifter{offset}.shift(procedure_declaration);
+}
+
+}
@@ -0,0 +1,14 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__AST_RELABEL_H
+#define PASCAL_COMPILER_TUTORIAL__AST_RELABEL_H
+
+#include "ast.h"
+
+namespace freezing::interpreter {
+
+// Adds the offset to the id of every node in the declaration, including its block and the nested declarations.
+// Used to place the ids of a declaration that was parsed on its own, with ids from 0, after the preceding nodes.
+void shift_node_ids(ProcedureDecl& procedure_declaration, NodeId offset);
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__AST_RELABEL_H
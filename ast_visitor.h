@@ -5,8 +5,10 @@
 #ifndef PASCAL_COMPILER_TUTORIAL__AST_VISITOR_H
 #define PASCAL_COMPILER_TUTORIAL__AST_VISITOR_H
 
+#include <cassert>
 #include <variant>
 #include "ast.h"
+#include "flat_ast.h"
 
 namespace freezing::interpreter {
 
@@ -17,11 +19,11 @@ struct NodeIdExtractorFn {
   }
 };
 
-static NodeId node_id(const Statement& statement) {
+inline NodeId node_id(const Statement& statement) {
   return std::visit(NodeIdExtractorFn{}, statement);
 }
 
-static NodeId node_id(const ExpressionNode& expression) {
+inline NodeId node_id(const ExpressionNode& expression) {
   return std::visit(NodeIdExtractorFn{}, expression);
 }
 
@@ -117,7 +119,10 @@ struct AstVisitorFn {
     for (const auto& param : procedure_decl.parameters) {
       visit(param);
     }
-    visit(*procedure_decl.block);
+    // Blocks that are parsed lazily are visited only once they're parsed.
+    if (const Block* block = procedure_decl.block->parsed()) {
+      visit(*block);
+    }
     std::invoke(callbacks.procedure_decl_post, procedure_decl);
   }
 
@@ -169,6 +174,84 @@ struct AstVisitorFn {
   }
 };
 
+// Same as AstVisitorCallbacks, but for the FlatAst. Callbacks receive the id of the node, whose properties are
+// looked up in the FlatAst.
+struct FlatAstVisitorCallbacks {
+  std::function<void(NodeId)> program_pre = [](NodeId) {};
+  std::function<void(NodeId)> program_post = [](NodeId) {};
+  std::function<void(NodeId)> block = [](NodeId) {};
+  std::function<void(NodeId)> var_decl_pre = [](NodeId) {};
+  std::function<void(NodeId)> var_decl_post = [](NodeId) {};
+  std::function<void(NodeId)> procedure_decl_pre = [](NodeId) {};
+  std::function<void(NodeId)> procedure_decl_post = [](NodeId) {};
+  std::function<void(NodeId)> param = [](NodeId) {};
+  std::function<void(NodeId)> compound_statement = [](NodeId) {};
+  std::function<void(NodeId)> assignment_statement = [](NodeId) {};
+  std::function<void(NodeId)> procedure_call_post = [](NodeId) {};
+  std::function<void(NodeId)> unary_op = [](NodeId) {};
+  std::function<void(NodeId)> bin_op = [](NodeId) {};
+  std::function<void(NodeId)> variable = [](NodeId) {};
+  std::function<void(NodeId)> num = [](NodeId) {};
+  std::function<void(NodeId)> empty = [](NodeId) {};
+};
+
+// Invokes the callbacks in the same order as AstVisitorFn does for the Program the FlatAst was created from.
+struct FlatAstVisitorFn {
+  FlatAstVisitorCallbacks callbacks;
+
+  void visit(const FlatAst& ast) const {
+    visit(ast, ast.root());
+  }
+
+  void visit(const FlatAst& ast, NodeId node_id) const {
+    switch (ast.kind(node_id)) {
+    case AstNodeKind::NONE:
+      assert(false && "Only the nodes of the tree are visited.");
+      return;
+    case AstNodeKind::PROGRAM:
+      return visit_children(ast, node_id, callbacks.program_pre, callbacks.program_post);
+    case AstNodeKind::BLOCK:
+      return visit_children(ast, node_id, nullptr, callbacks.block);
+    case AstNodeKind::VAR_DECL:
+      return visit_children(ast, node_id, callbacks.var_decl_pre, callbacks.var_decl_post);
+    case AstNodeKind::PROCEDURE_DECL:
+      return visit_children(ast, node_id, callbacks.procedure_decl_pre, callbacks.procedure_decl_post);
+    case AstNodeKind::PARAM:
+      return std::invoke(callbacks.param, node_id);
+    case AstNodeKind::COMPOUND_STATEMENT:
+      return visit_children(ast, node_id, nullptr, callbacks.compound_statement);
+    case AstNodeKind::ASSIGNMENT_STATEMENT:
+      return visit_children(ast, node_id, nullptr, callbacks.assignment_statement);
+    case AstNodeKind::PROCEDURE_CALL:
+      return visit_children(ast, node_id, nullptr, callbacks.procedure_call_post);
+    case AstNodeKind::BIN_OP:
+      return visit_children(ast, node_id, nullptr, callbacks.bin_op);
+    case AstNodeKind::UNARY_OP:
+      return visit_children(ast, node_id, nullptr, callbacks.unary_op);
+    case AstNodeKind::VARIABLE:
+      return std::invoke(callbacks.variable, node_id);
+    case AstNodeKind::NUM:
+      return std::invoke(callbacks.num, node_id);
+    case AstNodeKind::EMPTY:
+      return std::invoke(callbacks.empty, node_id);
+    }
+  }
+
+private:
+  void visit_children(const FlatAst& ast,
+                      NodeId node_id,
+                      const std::function<void(NodeId)>& pre,
+                      const std::function<void(NodeId)>& post) const {
+    if (pre) {
+      std::invoke(pre, node_id);
+    }
+    for (auto it = ast.children_begin(node_id); it != ast.children_end(node_id); ++it) {
+      visit(ast, *it);
+    }
+    std::invoke(post, node_id);
+  }
+};
+
 }
 
 #endif //PASCAL_COMPILER_TUTORIAL__AST_VISITOR_H
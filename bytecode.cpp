@@ -0,0 +1,45 @@
+#include <iomanip>
+#include "bytecode.h"
+
+namespace freezing::interpreter {
+
+std::ostream& operator<<(std::ostream& os, const Chunk& chunk) {
+  os << fmt::format("Chunk({}, num_slots={})", chunk.scope->name(), chunk.scope->num_slots()) << std::endl;
+  for (int ip = 0; ip < static_cast<int>(chunk.code.size()); ip++) {
+    const auto& instruction = chunk.code[ip];
+    os << std::setw(6) << ip << "  " << instruction.op_code;
+    switch (instruction.op_code) {
+    case OpCode::PUSH_CONST:
+      os << " " << chunk.constants[instruction.operand];
+      break;
+    case OpCode::LOAD:
+    case OpCode::STORE:
+      os << " " << chunk.scope->slot_names()[instruction.operand];
+      break;
+    case OpCode::LOAD_NONLOCAL:
+    case OpCode::STORE_NONLOCAL:
+      os << " " << static_cast<int>(instruction.depth) << ":" << instruction.operand;
+      break;
+    case OpCode::CALL:
+      os << " #" << instruction.operand << " depth=" << static_cast<int>(instruction.depth);
+      break;
+    case OpCode::ADD_INTEGER:
+    case OpCode::ADD_REAL:
+    case OpCode::SUBTRACT_INTEGER:
+    case OpCode::SUBTRACT_REAL:
+    case OpCode::MULTIPLY_INTEGER:
+    case OpCode::MULTIPLY_REAL:
+    case OpCode::DIVIDE_INTEGER:
+    case OpCode::DIVIDE_REAL:
+    case OpCode::NEGATE_INTEGER:
+    case OpCode::NEGATE_REAL:
+    case OpCode::INTEGER_TO_REAL:
+    case OpCode::RETURN:
+      break;
+    }
+    os << std::endl;
+  }
+  return os;
+}
+
+}
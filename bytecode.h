@@ -0,0 +1,146 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__BYTECODE_H
+#define PASCAL_COMPILER_TUTORIAL__BYTECODE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include "memory.h"
+#include "stringstream_formatter.h"
+#include "symbol_table.h"
+
+namespace freezing::interpreter {
+
+enum class OpCode : uint8_t {
+  // Pushes constants[operand] onto the operand stack.
+  PUSH_CONST,
+  // Pushes the value of the slot[operand] of the current frame.
+  LOAD,
+  // Pops the top of the operand stack into the slot[operand] of the current frame.
+  STORE,
+  // Same as LOAD and STORE, but for the frame that is depth static links away from the current one.
+  LOAD_NONLOCAL,
+  STORE_NONLOCAL,
+  // Arithmetic is specialized by the static type of the operands, which both have the same type.
+  ADD_INTEGER,
+  ADD_REAL,
+  SUBTRACT_INTEGER,
+  SUBTRACT_REAL,
+  MULTIPLY_INTEGER,
+  MULTIPLY_REAL,
+  DIVIDE_INTEGER,
+  DIVIDE_REAL,
+  NEGATE_INTEGER,
+  NEGATE_REAL,
+  // Converts INTEGER on the top of the operand stack to REAL.
+  INTEGER_TO_REAL,
+  // Calls chunks[operand], declared in the scope that is depth static links away from the current one.
+  // Arguments are on the top of the operand stack, the last argument being on the top.
+  CALL,
+  RETURN,
+};
+
+inline std::ostream& operator<<(std::ostream& os, const OpCode& op_code) {
+  std::string op_code_string = "UNKNOWN";
+  switch (op_code) {
+  case OpCode::PUSH_CONST:
+    op_code_string = "PUSH_CONST";
+    break;
+  case OpCode::LOAD:
+    op_code_string = "LOAD";
+    break;
+  case OpCode::STORE:
+    op_code_string = "STORE";
+    break;
+  case OpCode::LOAD_NONLOCAL:
+    op_code_string = "LOAD_NONLOCAL";
+    break;
+  case OpCode::STORE_NONLOCAL:
+    op_code_string = "STORE_NONLOCAL";
+    break;
+  case OpCode::ADD_INTEGER:
+    op_code_string = "ADD_INTEGER";
+    break;
+  case OpCode::ADD_REAL:
+    op_code_string = "ADD_REAL";
+    break;
+  case OpCode::SUBTRACT_INTEGER:
+    op_code_string = "SUBTRACT_INTEGER";
+    break;
+  case OpCode::SUBTRACT_REAL:
+    op_code_string = "SUBTRACT_REAL";
+    break;
+  case OpCode::MULTIPLY_INTEGER:
+    op_code_string = "MULTIPLY_INTEGER";
+    break;
+  case OpCode::MULTIPLY_REAL:
+    op_code_string = "MULTIPLY_REAL";
+    break;
+  case OpCode::DIVIDE_INTEGER:
+    op_code_string = "DIVIDE_INTEGER";
+    break;
+  case OpCode::DIVIDE_REAL:
+    op_code_string = "DIVIDE_REAL";
+    break;
+  case OpCode::NEGATE_INTEGER:
+    op_code_string = "NEGATE_INTEGER";
+    break;
+  case OpCode::NEGATE_REAL:
+    op_code_string = "NEGATE_REAL";
+    break;
+  case OpCode::INTEGER_TO_REAL:
+    op_code_string = "INTEGER_TO_REAL";
+    break;
+  case OpCode::CALL:
+    op_code_string = "CALL";
+    break;
+  case OpCode::RETURN:
+    op_code_string = "RETURN";
+    break;
+  }
+  return os << op_code_string;
+}
+
+struct Instruction {
+  OpCode op_code;
+  // Number of static links to follow. Only used by the NONLOCAL instructions and CALL.
+  uint8_t depth;
+  // Meaning depends on the op_code: constant index, slot index or chunk index. Unused otherwise.
+  int32_t operand;
+};
+
+static_assert(sizeof(Instruction) == 8, "Instructions are expected to be compact.");
+
+// Compiled body of a single procedure (or the main program).
+struct Chunk {
+  // Scope of the chunk, its slots are laid out as assigned by SemanticAnalyser.
+  // Formal parameters that are bound to arguments occupy the first num_params slots.
+  const SymbolTable* scope;
+  int num_params;
+  // Largest number of values on the operand stack while the chunk runs, so that the stack never grows during a run.
+  int max_stack_depth;
+  std::vector<DataType> constants;
+  std::vector<Instruction> code;
+};
+
+struct BytecodeProgram {
+  std::vector<Chunk> chunks;
+  // Index of the chunk that holds the main program.
+  int entry_chunk;
+};
+
+std::ostream& operator<<(std::ostream& os, const Chunk& chunk);
+
+}
+
+template<>
+struct fmt::formatter<freezing::interpreter::OpCode>
+    : freezing::interpreter::StringStreamFormatter<freezing::interpreter::OpCode> {
+};
+
+template<>
+struct fmt::formatter<freezing::interpreter::Chunk>
+    : freezing::interpreter::StringStreamFormatter<freezing::interpreter::Chunk> {
+};
+
+#endif //PASCAL_COMPILER_TUTORIAL__BYTECODE_H
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cassert>
+#include "bytecode_compiler.h"
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+static OpCode binary_op_code(TokenType token_type, ValueType type) {
+  bool is_integer = type == ValueType::INTEGER;
+  switch (token_type) {
+  case TokenType::PLUS:
+    return is_integer ? OpCode::ADD_INTEGER : OpCode::ADD_REAL;
+  case TokenType::MINUS:
+    return is_integer ? OpCode::SUBTRACT_INTEGER : OpCode::SUBTRACT_REAL;
+  case TokenType::MUL:
+    return is_integer ? OpCode::MULTIPLY_INTEGER : OpCode::MULTIPLY_REAL;
+  case TokenType::INTEGER_DIV:
+  case TokenType::REAL_DIV:
+    return is_integer ? OpCode::DIVIDE_INTEGER : OpCode::DIVIDE_REAL;
+  default:
+    break;
+  }
+  assert(false && "Parser guarantees that BinOp is one of PLUS, MINUS, MUL, INTEGER_DIV, REAL_DIV.");
+  return OpCode::ADD_INTEGER;
+}
+
+}
+
+BytecodeProgram BytecodeCompiler::compile(const Program& program, const SemanticModel& semantic_model) {
+  semantic_model_ = &semantic_model;
+  program_ = BytecodeProgram{};
+  chunk_indices_.assign(semantic_model.scopes.size(), -1);
+
+  program_.entry_chunk = declare_chunk(0);
+  declare_procedures(program.block);
+  compile_chunk(program_.entry_chunk, program.block);
+  return std::move(program_);
+}
+
+int BytecodeCompiler::declare_chunk(ScopeId scope) {
+  int chunk_index = program_.chunks.size();
+  program_.chunks.push_back(Chunk{&semantic_model_->scopes[scope], 0, 0, {}, {}});
+  chunk_indices_[scope] = chunk_index;
+  return chunk_index;
+}
+
+void BytecodeCompiler::declare_procedures(const Block& block) {
+  for (const auto& procedure_decl : block.procedure_declarations) {
+    declare_chunk(semantic_model_->procedure_scopes.at(procedure_decl.id));
+    declare_procedures(*procedure_decl.block->parsed());
+  }
+}
+
+void BytecodeCompiler::compile_chunk(int chunk_index, const Block& block) {
+  // All chunks are declared up front, so the reference into program_.chunks stays valid.
+  Chunk& chunk = program_.chunks[chunk_index];
+  chunk.num_params = chunk.scope->num_parameters();
+  stack_depth_ = 0;
+  compile(chunk, block.compound_statement);
+  emit(chunk, OpCode::RETURN, 0, 0);
+
+  for (const auto& procedure_decl : block.procedure_declarations) {
+    compile_chunk(chunk_indices_[semantic_model_->procedure_scopes.at(procedure_decl.id)],
+                  *procedure_decl.block->parsed());
+  }
+}
+
+void BytecodeCompiler::compile(Chunk& chunk, const Statement& statement) {
+  std::visit([this, &chunk](const auto& node) {
+    using T = std::decay_t<decltype(node)>;
+    if constexpr (!std::is_same_v<T, Empty>) {
+      compile(chunk, node);
+    }
+  }, statement);
+}
+
+void BytecodeCompiler::compile(Chunk& chunk, const CompoundStatement& compound_statement) {
+  for (const auto& statement : compound_statement.statements) {
+    compile(chunk, statement);
+  }
+}
+
+void BytecodeCompiler::compile(Chunk& chunk, const AssignmentStatement& assignment_statement) {
+  const auto& variable = assignment_statement.variable;
+  compile(chunk, assignment_statement.expression, semantic_model_->expression_types[variable.id]);
+  const auto& address = semantic_model_->addresses[variable.id];
+  if (address.depth == 0) {
+    emit(chunk, OpCode::STORE, 1, 0, address.slot);
+  } else {
+    emit(chunk, OpCode::STORE_NONLOCAL, 1, 0, address.slot, address.depth);
+  }
+}
+
+void BytecodeCompiler::compile(Chunk& chunk, const ProcedureCall& procedure_call) {
+  const auto* procedure_symbol = semantic_model_->call_targets[procedure_call.id];
+  assert(procedure_symbol != nullptr && "SemanticAnalyser resolves every procedure call.");
+  // Only the arguments of the bound parameters are pushed, in the order of their slots.
+  for (size_t param_idx = 0; param_idx < procedure_call.parameters.size(); param_idx++) {
+    if (procedure_symbol->parameter_slots[param_idx] == -1) {
+      continue;
+    }
+    compile(chunk,
+            procedure_call.parameters[param_idx],
+            value_type_of(procedure_symbol->parameters[param_idx].type_specification));
+  }
+  int chunk_index = chunk_indices_[procedure_symbol->scope->id()];
+  assert(chunk_index != -1);
+  emit(chunk, OpCode::CALL, procedure_symbol->scope->num_parameters(), 0, chunk_index,
+       semantic_model_->addresses[procedure_call.id].depth);
+}
+
+void BytecodeCompiler::compile(Chunk& chunk, const ExpressionNode& expression_node, ValueType type) {
+  struct ExpressionNodeCompileFn {
+    BytecodeCompiler& self;
+    Chunk& chunk;
+
+    void operator()(const BinOp& bin_op) {
+      // Both operands are promoted to the type of the operation.
+      auto type = self.semantic_model_->expression_types[bin_op.id];
+      self.compile(chunk, *bin_op.left, type);
+      self.compile(chunk, *bin_op.right, type);
+      self.emit(chunk, detail::binary_op_code(bin_op.op_type, type), 2, 1);
+    }
+
+    void operator()(const UnaryOp& unary_op) {
+      auto type = self.semantic_model_->expression_types[unary_op.id];
+      self.compile(chunk, *unary_op.node, type);
+      if (unary_op.op_type == TokenType::MINUS) {
+        self.emit(chunk, type == ValueType::INTEGER ? OpCode::NEGATE_INTEGER : OpCode::NEGATE_REAL, 1, 1);
+      }
+    }
+
+    void operator()(const Variable& variable) {
+      const auto& address = self.semantic_model_->addresses[variable.id];
+      if (address.depth == 0) {
+        self.emit(chunk, OpCode::LOAD, 0, 1, address.slot);
+      } else {
+        self.emit(chunk, OpCode::LOAD_NONLOCAL, 0, 1, address.slot, address.depth);
+      }
+    }
+
+    void operator()(const Num&) {
+      assert(false && "Num nodes are compiled as constants.");
+    }
+  };
+
+  NodeId expression_id = node_id(expression_node);
+  bool is_promoted =
+      type == ValueType::REAL && semantic_model_->expression_types[expression_id] == ValueType::INTEGER;
+  std::optional<NumType> constant_value = semantic_model_->constant_values[expression_id];
+  if (const auto* num = std::get_if<Num>(&expression_node)) {
+    constant_value = num->value;
+  }
+  if (!constant_value) {
+    std::visit(ExpressionNodeCompileFn{*this, chunk}, expression_node);
+    if (is_promoted) {
+      emit(chunk, OpCode::INTEGER_TO_REAL, 1, 1);
+    }
+    return;
+  }
+  // Constants are promoted at compile time.
+  emit(chunk, OpCode::PUSH_CONST, 0, 1, chunk.constants.size());
+  chunk.constants.push_back(is_promoted ? DataType{static_cast<double>(std::get<int>(*constant_value))}
+                                        : *constant_value);
+}
+
+void BytecodeCompiler::emit(Chunk& chunk, OpCode op_code, int num_popped, int num_pushed, int32_t operand, int depth) {
+  assert(depth <= UINT8_MAX && "Nesting depth doesn't fit into the instruction.");
+  chunk.code.push_back(Instruction{op_code, static_cast<uint8_t>(depth), operand});
+  assert(stack_depth_ >= num_popped);
+  stack_depth_ += num_pushed - num_popped;
+  chunk.max_stack_depth = std::max(chunk.max_stack_depth, stack_depth_);
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__BYTECODE_COMPILER_H
+#define PASCAL_COMPILER_TUTORIAL__BYTECODE_COMPILER_H
+
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "semantic_analyser.h"
+
+namespace freezing::interpreter {
+
+// Lowers a program that passed semantic analysis into linear bytecode, one chunk per procedure.
+// Compilation of a checked program can't fail: every variable and procedure is already resolved in the
+// semantic model.
+class BytecodeCompiler {
+public:
+  // Blocks of all procedures must be parsed and analysed.
+  BytecodeProgram compile(const Program& program, const SemanticModel& semantic_model);
+
+private:
+  const SemanticModel* semantic_model_;
+  BytecodeProgram program_;
+  // Chunk of each procedure, indexed by the ScopeId of its body.
+  std::vector<int> chunk_indices_;
+  // Number of values on the operand stack after the instructions emitted so far into the current chunk.
+  int stack_depth_;
+
+  int declare_chunk(ScopeId scope);
+  void declare_procedures(const Block& block);
+  void compile_chunk(int chunk_index, const Block& block);
+
+  void compile(Chunk& chunk, const Statement& statement);
+  void compile(Chunk& chunk, const CompoundStatement& compound_statement);
+  void compile(Chunk& chunk, const AssignmentStatement& assignment_statement);
+  void compile(Chunk& chunk, const ProcedureCall& procedure_call);
+  // Compiles the expression so that it leaves a value of the given type on the operand stack.
+  // The type is either the same as the static type of the expression or REAL, in which case INTEGER is promoted.
+  void compile(Chunk& chunk, const ExpressionNode& expression_node, ValueType type);
+
+  // Emits the instruction, which pops num_popped values off the operand stack and pushes num_pushed values onto it.
+  void emit(Chunk& chunk, OpCode op_code, int num_popped, int num_pushed, int32_t operand = 0, int depth = 0);
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__BYTECODE_COMPILER_H
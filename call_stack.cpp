@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cassert>
+#include "call_stack.h"
+
+namespace freezing::interpreter {
+
+CallStack::CallStack(int initial_num_slots, int initial_num_frames) : slots_(initial_num_slots), num_used_slots_{0} {
+  frames_.reserve(initial_num_frames);
+}
+
+StackFrame CallStack::allocate(const SymbolTable& scope, int static_link) {
+  int base = num_used_slots_;
+  int num_slots = scope.num_slots();
+  if (base + num_slots > static_cast<int>(slots_.size())) {
+    grow(base + num_slots);
+  }
+  std::fill_n(slots_.begin() + base, num_slots, std::nullopt);
+  num_used_slots_ += num_slots;
+  return StackFrame{&scope, static_link, base, slots_.data() + base};
+}
+
+void CallStack::push(const StackFrame& frame) {
+  assert(frame.base + frame.scope->num_slots() == num_used_slots_ && "Only the last allocated frame can be pushed.");
+  frames_.push_back(frame);
+}
+
+void CallStack::release(const StackFrame& frame) {
+  assert(frame.base + frame.scope->num_slots() == num_used_slots_ && "Only the last allocated frame can be released.");
+  num_used_slots_ = frame.base;
+}
+
+void CallStack::pop() {
+  assert(!frames_.empty());
+  num_used_slots_ = frames_.back().base;
+  frames_.pop_back();
+}
+
+StackFrame& CallStack::top() {
+  return frames_.back();
+}
+
+const StackFrame& CallStack::top() const {
+  return frames_.back();
+}
+
+StackFrame& CallStack::operator[](int frame_index) {
+  return frames_[frame_index];
+}
+
+const StackFrame& CallStack::operator[](int frame_index) const {
+  return frames_[frame_index];
+}
+
+int CallStack::size() const {
+  return frames_.size();
+}
+
+bool CallStack::empty() const {
+  return frames_.empty();
+}
+
+int CallStack::frame_index_at(int depth) const {
+  int frame_index = frames_.size() - 1;
+  for (int i = 0; i < depth; i++) {
+    frame_index = frames_[frame_index].static_link;
+  }
+  assert(frame_index >= 0 && "SemanticAnalyser guarantees that the enclosing scope exists.");
+  return frame_index;
+}
+
+void CallStack::grow(int min_num_slots) {
+  slots_.resize(std::max<int>(min_num_slots, 2 * slots_.size()));
+  // Growing moves the region, so the frames have to be pointed to the new one.
+  for (auto& frame : frames_) {
+    frame.slots = slots_.data() + frame.base;
+  }
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__CALL_STACK_H
+#define PASCAL_COMPILER_TUTORIAL__CALL_STACK_H
+
+#include <vector>
+#include "stack_frame.h"
+
+namespace freezing::interpreter {
+
+// Stack of active frames, whose slots are bump allocated from a single contiguous region.
+// The region is preallocated and only grows when a call goes deeper than ever before, so calls don't allocate
+// once the stack is warmed up.
+class CallStack {
+public:
+  explicit CallStack(int initial_num_slots = kDefaultNumSlots, int initial_num_frames = kDefaultNumFrames);
+
+  // Allocates the slots of a new frame, with all variables uninitialized.
+  // The frame becomes the top of the stack only after it's pushed, which lets the caller evaluate the arguments
+  // in its own frame. Nothing else may be allocated in between.
+  StackFrame allocate(const SymbolTable& scope, int static_link);
+  void push(const StackFrame& frame);
+  // Releases the frame returned by allocate() that has never been pushed.
+  void release(const StackFrame& frame);
+  // Releases the top frame together with its slots.
+  void pop();
+
+  StackFrame& top();
+  const StackFrame& top() const;
+  StackFrame& operator[](int frame_index);
+  const StackFrame& operator[](int frame_index) const;
+  int size() const;
+  bool empty() const;
+
+  // Returns the index of the frame that is depth static links away from the top one.
+  int frame_index_at(int depth) const;
+
+private:
+  static constexpr int kDefaultNumSlots = 4096;
+  static constexpr int kDefaultNumFrames = 256;
+
+  std::vector<std::optional<DataType>> slots_;
+  int num_used_slots_;
+  std::vector<StackFrame> frames_;
+
+  void grow(int min_num_slots);
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__CALL_STACK_H
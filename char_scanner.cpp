@@ -0,0 +1,162 @@
+#include "char_scanner.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+#if defined(__AVX2__)
+
+// Every match function returns 0xFF in the bytes of the matching characters.
+inline __m256i in_range(__m256i chars, char low, char high) {
+  __m256i clamped = _mm256_min_epu8(_mm256_max_epu8(chars, _mm256_set1_epi8(low)), _mm256_set1_epi8(high));
+  return _mm256_cmpeq_epi8(clamped, chars);
+}
+
+inline __m256i equal_to(__m256i chars, char c) {
+  return _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(c));
+}
+
+inline __m256i not_equal_to(__m256i chars, char c) {
+  return _mm256_andnot_si256(equal_to(chars, c), _mm256_set1_epi8(-1));
+}
+
+inline __m256i either(__m256i matches, __m256i other_matches) {
+  return _mm256_or_si256(matches, other_matches);
+}
+
+inline __m256i lower_case(__m256i chars) {
+  return _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+}
+
+inline uint32_t to_mask(__m256i matches) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+}
+
+inline __m256i load(const char* data) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+}
+
+constexpr int kBlockSize = 32;
+
+#elif defined(__SSE2__)
+
+// Every match function returns 0xFF in the bytes of the matching characters.
+inline __m128i in_range(__m128i chars, char low, char high) {
+  __m128i clamped = _mm_min_epu8(_mm_max_epu8(chars, _mm_set1_epi8(low)), _mm_set1_epi8(high));
+  return _mm_cmpeq_epi8(clamped, chars);
+}
+
+inline __m128i equal_to(__m128i chars, char c) {
+  return _mm_cmpeq_epi8(chars, _mm_set1_epi8(c));
+}
+
+inline __m128i not_equal_to(__m128i chars, char c) {
+  return _mm_andnot_si128(equal_to(chars, c), _mm_set1_epi8(-1));
+}
+
+inline __m128i either(__m128i matches, __m128i other_matches) {
+  return _mm_or_si128(matches, other_matches);
+}
+
+inline __m128i lower_case(__m128i chars) {
+  return _mm_or_si128(chars, _mm_set1_epi8(0x20));
+}
+
+inline uint32_t to_mask(__m128i matches) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+}
+
+inline __m128i load(const char* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+constexpr int kBlockSize = 16;
+
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+constexpr uint32_t kFullMask = kBlockSize == 32 ? 0xFFFFFFFFu : 0xFFFFu;
+
+// Skips the whole blocks whose characters all match, and returns the position of the first block that doesn't.
+// Remaining characters are left to the scalar loop.
+template<typename MatchBlockFn>
+int skip_blocks(std::string_view text, int pos, MatchBlockFn match_block) {
+  while (pos + kBlockSize <= static_cast<int>(text.size())) {
+    uint32_t mask = to_mask(match_block(load(text.data() + pos)));
+    if (mask != kFullMask) {
+      return pos + __builtin_ctz(~mask);
+    }
+    pos += kBlockSize;
+  }
+  return pos;
+}
+
+#endif
+
+template<typename MatchCharFn>
+int skip_chars(std::string_view text, int pos, MatchCharFn match_char) {
+  while (pos < static_cast<int>(text.size()) && match_char(text[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+}
+
+int skip_spaces(std::string_view text, int pos) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  pos = detail::skip_blocks(text, pos, [](auto chars) {
+    return detail::either(detail::in_range(chars, '\t', '\r'), detail::equal_to(chars, ' '));
+  });
+#endif
+  return detail::skip_chars(text, pos, is_space_char);
+}
+
+int skip_digits(std::string_view text, int pos) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  pos = detail::skip_blocks(text, pos, [](auto chars) {
+    return detail::in_range(chars, '0', '9');
+  });
+#endif
+  return detail::skip_chars(text, pos, is_digit_char);
+}
+
+int skip_alnums(std::string_view text, int pos) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  pos = detail::skip_blocks(text, pos, [](auto chars) {
+    return detail::either(detail::in_range(chars, '0', '9'), detail::in_range(detail::lower_case(chars), 'a', 'z'));
+  });
+#endif
+  return detail::skip_chars(text, pos, is_alnum_char);
+}
+
+int find_char(std::string_view text, int pos, char c) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  pos = detail::skip_blocks(text, pos, [c](auto chars) {
+    return detail::not_equal_to(chars, c);
+  });
+#endif
+  return detail::skip_chars(text, pos, [c](char other) { return other != c; });
+}
+
+int count_char(std::string_view text, int begin, int end, char c) {
+  int count = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; begin + detail::kBlockSize <= end; begin += detail::kBlockSize) {
+    count += __builtin_popcount(detail::to_mask(detail::equal_to(detail::load(text.data() + begin), c)));
+  }
+#endif
+  for (; begin < end; begin++) {
+    count += text[begin] == c;
+  }
+  return count;
+}
+
+}
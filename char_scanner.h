@@ -0,0 +1,76 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__CHAR_SCANNER_H
+#define PASCAL_COMPILER_TUTORIAL__CHAR_SCANNER_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace freezing::interpreter {
+
+// Table driven replacement for the locale sensitive <cctype> functions. Only ASCII characters are classified.
+enum CharClass : uint8_t {
+  kSpaceChar = 1 << 0,
+  kDigitChar = 1 << 1,
+  kAlphaChar = 1 << 2,
+};
+
+namespace detail {
+
+constexpr std::array<uint8_t, 256> make_char_class_table() {
+  std::array<uint8_t, 256> table{};
+  for (int c = '\t'; c <= '\r'; c++) {
+    table[c] |= kSpaceChar;
+  }
+  table[' '] |= kSpaceChar;
+  for (int c = '0'; c <= '9'; c++) {
+    table[c] |= kDigitChar;
+  }
+  for (int c = 'a'; c <= 'z'; c++) {
+    table[c] |= kAlphaChar;
+    table[c - 'a' + 'A'] |= kAlphaChar;
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> kCharClassTable = make_char_class_table();
+
+}
+
+constexpr bool has_char_class(char c, uint8_t char_class) {
+  return (detail::kCharClassTable[static_cast<uint8_t>(c)] & char_class) != 0;
+}
+
+constexpr bool is_space_char(char c) {
+  return has_char_class(c, kSpaceChar);
+}
+
+constexpr bool is_digit_char(char c) {
+  return has_char_class(c, kDigitChar);
+}
+
+constexpr bool is_alpha_char(char c) {
+  return has_char_class(c, kAlphaChar);
+}
+
+constexpr bool is_alnum_char(char c) {
+  return has_char_class(c, kDigitChar | kAlphaChar);
+}
+
+// Scanning functions used by the lexer to skip over runs of characters. They process 32 (AVX2) or 16 (SSE2) bytes
+// at a time when the target supports it, and fall back to the table driven classification otherwise.
+// All of them return text.size() if the run reaches the end of the text.
+
+// Returns the position of the first non space character at or after pos.
+int skip_spaces(std::string_view text, int pos);
+// Returns the position of the first non digit character at or after pos.
+int skip_digits(std::string_view text, int pos);
+// Returns the position of the first non alphanumeric character at or after pos.
+int skip_alnums(std::string_view text, int pos);
+// Returns the position of the first occurrence of c at or after pos.
+int find_char(std::string_view text, int pos, char c);
+// Returns the number of occurrences of c in text[begin, end).
+int count_char(std::string_view text, int begin, int end, char c);
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__CHAR_SCANNER_H
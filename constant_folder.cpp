@@ -0,0 +1,210 @@
+#include "constant_folder.h"
+
+#include <cstdint>
+#include <limits>
+#include "arithmetic.h"
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+// INTEGER operations are folded as int64_t, the results that don't fit into int would overflow at run time.
+std::optional<NumType> integer_constant(int64_t value) {
+  if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+    return std::nullopt;
+  }
+  return static_cast<int>(value);
+}
+
+// Promotes the constant if it's INTEGER.
+double real_constant(const NumType& value) {
+  return std::visit([](auto v) { return static_cast<double>(v); }, value);
+}
+
+std::optional<NumType> fold_bin_op(int left, TokenType op_type, int right) {
+  auto result = Calculate<int64_t>(left, op_type, right);
+  if (!result) {
+    return std::nullopt;
+  }
+  return integer_constant(*result);
+}
+
+std::optional<NumType> fold_bin_op(double left, TokenType op_type, double right) {
+  auto result = Calculate(left, op_type, right);
+  if (!result) {
+    return std::nullopt;
+  }
+  return *result;
+}
+
+std::optional<NumType> fold_unary_op(int value, TokenType op_type) {
+  return integer_constant(UnaryCalculate<int64_t>(value, op_type));
+}
+
+std::optional<NumType> fold_unary_op(double value, TokenType op_type) {
+  return UnaryCalculate(value, op_type);
+}
+
+}
+
+void ConstantFolder::fold(const Program& program, SemanticModel& semantic_model) {
+  fold_block(program.block, 0, semantic_model);
+}
+
+void ConstantFolder::fold_block(const Block& block, ScopeId scope, SemanticModel& semantic_model) {
+  semantic_model_ = &semantic_model;
+  // Variables can only be assigned in the block of their scope and in the nested procedures, so only the scopes of
+  // these blocks are counted.
+  assignment_counts_.assign(semantic_model.scopes.size(), {});
+  are_counts_complete_.assign(semantic_model.scopes.size(), false);
+  count_assignments(block, scope);
+  fold_blocks(block, scope);
+}
+
+const Block* ConstantFolder::analysed_block(const ProcedureDecl& procedure_decl) const {
+  const Block* block = procedure_decl.block->parsed();
+  if (block == nullptr || semantic_model_->unanalysed_blocks.count(procedure_decl.block) > 0) {
+    return nullptr;
+  }
+  return block;
+}
+
+void ConstantFolder::count_assignments(const Block& block, ScopeId scope) {
+  assignment_counts_[scope].assign(semantic_model_->scopes[scope].num_slots(), 0);
+  are_counts_complete_[scope] = true;
+  count_assignments(block.compound_statement, scope);
+  for (const auto& procedure_decl : block.procedure_declarations) {
+    const Block* nested_block = analysed_block(procedure_decl);
+    if (nested_block == nullptr) {
+      // Procedure may assign the variables of any of the enclosing scopes.
+      for (ScopeId enclosing = scope; enclosing != -1; enclosing = semantic_model_->parent_scopes[enclosing]) {
+        are_counts_complete_[enclosing] = false;
+      }
+      continue;
+    }
+    count_assignments(*nested_block, semantic_model_->procedure_scopes.at(procedure_decl.id));
+  }
+}
+
+void ConstantFolder::count_assignments(const CompoundStatement& compound_statement, ScopeId scope) {
+  for (const auto& statement : compound_statement.statements) {
+    if (const auto* nested_statement = std::get_if<CompoundStatement>(&statement)) {
+      count_assignments(*nested_statement, scope);
+      continue;
+    }
+    const auto* assignment_statement = std::get_if<AssignmentStatement>(&statement);
+    if (assignment_statement == nullptr) {
+      continue;
+    }
+    const auto& address = semantic_model_->addresses[assignment_statement->variable.id];
+    ScopeId defining_scope = scope;
+    for (int depth = 0; depth < address.depth; depth++) {
+      defining_scope = semantic_model_->parent_scopes[defining_scope];
+    }
+    // Scopes outside of the counted blocks aren't folded, so they have no counts.
+    auto& counts = assignment_counts_[defining_scope];
+    if (!counts.empty()) {
+      counts[address.slot]++;
+    }
+  }
+}
+
+void ConstantFolder::fold_blocks(const Block& block, ScopeId scope) {
+  scope_ = scope;
+  variable_values_.assign(semantic_model_->scopes[scope].num_slots(), std::nullopt);
+  fold(block.compound_statement);
+  for (const auto& procedure_decl : block.procedure_declarations) {
+    if (const Block* nested_block = analysed_block(procedure_decl)) {
+      fold_blocks(*nested_block, semantic_model_->procedure_scopes.at(procedure_decl.id));
+    }
+  }
+}
+
+void ConstantFolder::fold(const Statement& statement) {
+  std::visit([this](const auto& node) {
+    using T = std::decay_t<decltype(node)>;
+    if constexpr (!std::is_same_v<T, Empty>) {
+      fold(node);
+    }
+  }, statement);
+}
+
+void ConstantFolder::fold(const CompoundStatement& compound_statement) {
+  for (const auto& statement : compound_statement.statements) {
+    fold(statement);
+  }
+}
+
+void ConstantFolder::fold(const AssignmentStatement& assignment_statement) {
+  auto value = fold(assignment_statement.expression);
+  const auto& variable = assignment_statement.variable;
+  const auto& address = semantic_model_->addresses[variable.id];
+  if (address.depth != 0 || !are_counts_complete_[scope_] || assignment_counts_[scope_][address.slot] != 1) {
+    return;
+  }
+  // Statements are executed in order, so the variable holds the value in all the statements that follow.
+  if (value && semantic_model_->expression_types[variable.id] == ValueType::REAL) {
+    value = detail::real_constant(*value);
+  }
+  variable_values_[address.slot] = value;
+}
+
+void ConstantFolder::fold(const ProcedureCall& procedure_call) {
+  for (const auto& argument : procedure_call.parameters) {
+    fold(argument);
+  }
+}
+
+std::optional<NumType> ConstantFolder::fold(const ExpressionNode& expression_node) {
+  struct ExpressionNodeFoldFn {
+    ConstantFolder& self;
+
+    std::optional<NumType> operator()(const BinOp& bin_op) {
+      // Both operands are folded, even if the other one isn't constant.
+      auto left = self.fold(*bin_op.left);
+      auto right = self.fold(*bin_op.right);
+      if (!left || !right) {
+        return std::nullopt;
+      }
+      // Both operands are promoted to the type of the operation.
+      if (self.semantic_model_->expression_types[bin_op.id] == ValueType::INTEGER) {
+        return record(bin_op.id,
+                      detail::fold_bin_op(detail::as_integer(*left), bin_op.op_type, detail::as_integer(*right)));
+      }
+      return record(bin_op.id,
+                    detail::fold_bin_op(detail::real_constant(*left), bin_op.op_type, detail::real_constant(*right)));
+    }
+
+    std::optional<NumType> operator()(const UnaryOp& unary_op) {
+      auto value = self.fold(*unary_op.node);
+      if (!value) {
+        return std::nullopt;
+      }
+      if (self.semantic_model_->expression_types[unary_op.id] == ValueType::INTEGER) {
+        return record(unary_op.id, detail::fold_unary_op(detail::as_integer(*value), unary_op.op_type));
+      }
+      return record(unary_op.id, detail::fold_unary_op(detail::as_real(*value), unary_op.op_type));
+    }
+
+    std::optional<NumType> operator()(const Variable& variable) {
+      const auto& address = self.semantic_model_->addresses[variable.id];
+      if (address.depth != 0) {
+        return std::nullopt;
+      }
+      return record(variable.id, self.variable_values_[address.slot]);
+    }
+
+    std::optional<NumType> operator()(const Num& num) {
+      return num.value;
+    }
+
+    std::optional<NumType> record(NodeId node_id, std::optional<NumType> value) {
+      self.semantic_model_->constant_values[node_id] = value;
+      return value;
+    }
+  };
+
+  return std::visit(ExpressionNodeFoldFn{*this}, expression_node);
+}
+
+}
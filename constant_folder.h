@@ -0,0 +1,56 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__CONSTANT_FOLDER_H
+#define PASCAL_COMPILER_TUTORIAL__CONSTANT_FOLDER_H
+
+#include <optional>
+#include <vector>
+#include "ast.h"
+#include "semantic_analyser.h"
+
+namespace freezing::interpreter {
+
+// Evaluates the constant expressions of an analysed program once, at compile time, and records their values in
+// SemanticModel::constant_values, which both execution modes use instead of evaluating the expressions. The program
+// itself isn't changed.
+//
+// Operations over constants are folded with the same kernels that evaluate them at run time. Those that fail or whose
+// INTEGER result overflows, e.g. a division by zero, are left to run time, so that they report the same errors.
+// A variable that is assigned only once, by a constant in the block of its own scope, is also a constant in the
+// statements of that block that follow the assignment.
+class ConstantFolder {
+public:
+  // Folds the blocks that are analysed. Variables of a block aren't propagated while some of its nested procedures
+  // aren't analysed, since those might assign them.
+  void fold(const Program& program, SemanticModel& semantic_model);
+
+  // Folds the block of a procedure, and the nested blocks, once it's analysed after the rest of the program.
+  void fold_block(const Block& block, ScopeId scope, SemanticModel& semantic_model);
+
+private:
+  SemanticModel* semantic_model_;
+  // Indexed by ScopeId and slot. Number of assignments to each variable, in the block of its scope and the nested
+  // procedures.
+  std::vector<std::vector<int>> assignment_counts_;
+  // Indexed by ScopeId. Whether the blocks of all the nested procedures were counted.
+  std::vector<bool> are_counts_complete_;
+  // Scope of the block that is being folded.
+  ScopeId scope_;
+  // Indexed by slot. Values of the variables of the block that is being folded, from the statements folded so far.
+  std::vector<std::optional<NumType>> variable_values_;
+
+  // Returns the block of the procedure, or nullptr if it isn't parsed and analysed yet.
+  const Block* analysed_block(const ProcedureDecl& procedure_decl) const;
+  void count_assignments(const Block& block, ScopeId scope);
+  void count_assignments(const CompoundStatement& compound_statement, ScopeId scope);
+  void fold_blocks(const Block& block, ScopeId scope);
+
+  void fold(const Statement& statement);
+  void fold(const CompoundStatement& compound_statement);
+  void fold(const AssignmentStatement& assignment_statement);
+  void fold(const ProcedureCall& procedure_call);
+  // Returns the value of the expression in its static type, or nullopt if it isn't constant.
+  std::optional<NumType> fold(const ExpressionNode& expression_node);
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__CONSTANT_FOLDER_H
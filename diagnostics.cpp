@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <fmt/format.h>
+#include "diagnostics.h"
+#include "line_table.h"
+
+namespace freezing::interpreter {
+
+std::string Diagnostic::message() const {
+  switch (code) {
+  case DiagnosticCode::UNKNOWN_CHARACTER:
+    return fmt::format("Unknown character sequence: {}", arguments[0]);
+  case DiagnosticCode::CONSTANT_OUT_OF_RANGE:
+    return fmt::format("{} constant {} is out of range.", arguments[0], arguments[1]);
+  case DiagnosticCode::MISSING_EXPONENT_DIGITS:
+    return fmt::format("Expected digits in the exponent of the constant {}.", arguments[0]);
+  case DiagnosticCode::UNEXPECTED_TOKEN:
+    return fmt::format("Unexpected token found. Expected: {}. Actual: Token({}, lexeme={}).",
+                       arguments[0], arguments[1], arguments[2]);
+  case DiagnosticCode::UNEXPECTED_TOKEN_IN_FACTOR:
+    return fmt::format("Unexpected token {} found while trying to parse factor.", arguments[0]);
+  case DiagnosticCode::EXPECTED_TYPE:
+    return fmt::format("Expected type 'INTEGER' or 'REAL', but got token: 'Token({}, lexeme={})'",
+                       arguments[0], arguments[1]);
+  case DiagnosticCode::UNBALANCED_PROCEDURE_BODY:
+    return fmt::format("Procedure body isn't balanced, unexpected token: 'Token({}, lexeme={})'",
+                       arguments[0], arguments[1]);
+  }
+  return "Unknown diagnostic";
+}
+
+DiagnosticsEngine::DiagnosticsEngine(const SourceManager& source_manager) : source_manager_{source_manager} {}
+
+void DiagnosticsEngine::report(Diagnostic diagnostic) {
+  diagnostics_.push_back(std::move(diagnostic));
+}
+
+const std::vector<Diagnostic>& DiagnosticsEngine::diagnostics() const {
+  return diagnostics_;
+}
+
+std::string DiagnosticsEngine::render(const Diagnostic& diagnostic) const {
+  std::string_view text = source_manager_.text(diagnostic.source_id);
+  const LineTable& line_table = source_manager_.line_table(diagnostic.source_id);
+  CharLocation location = line_table.location(diagnostic.offset);
+
+  // Lines are counted from 1 when they are shown, as editors do.
+  std::string result = fmt::format("{}:{}:{}: {}\n",
+                                   source_manager_.name(diagnostic.source_id),
+                                   location.line_number + 1,
+                                   location.column_number,
+                                   diagnostic.message());
+  int first_line = std::max(0, location.line_number - kContextLines);
+  int last_line = std::min(line_table.num_lines() - 1, location.line_number + kContextLines);
+  for (int line_number = first_line; line_number <= last_line; line_number++) {
+    result += fmt::format("{:>6}|{}\n", line_number + 1, line_table.line(text, line_number));
+    if (line_number == location.line_number) {
+      // Points to the column, past the line number and the separator.
+      result += std::string(location.column_number - 1 + 7, '-') + "^\n";
+    }
+  }
+  return result;
+}
+
+}
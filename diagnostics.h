@@ -0,0 +1,67 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__DIAGNOSTICS_H
+#define PASCAL_COMPILER_TUTORIAL__DIAGNOSTICS_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "source_manager.h"
+
+namespace freezing::interpreter {
+
+enum class DiagnosticCode : uint16_t {
+  // Arguments: the character.
+  UNKNOWN_CHARACTER,
+  // Arguments: the type of the constant, the constant.
+  CONSTANT_OUT_OF_RANGE,
+  // Arguments: the constant up to the exponent.
+  MISSING_EXPONENT_DIGITS,
+  // Arguments: expected token type, actual token type, actual lexeme.
+  UNEXPECTED_TOKEN,
+  // Arguments: actual token type.
+  UNEXPECTED_TOKEN_IN_FACTOR,
+  // Arguments: actual token type, actual lexeme.
+  EXPECTED_TYPE,
+  // Arguments: actual token type, actual lexeme.
+  UNBALANCED_PROCEDURE_BODY,
+};
+
+// Error found in the source. Only what's needed to describe it is recorded, the message and the location are
+// formatted only if the diagnostic is rendered.
+struct Diagnostic {
+  DiagnosticCode code;
+  SourceId source_id;
+  // Offset of the first character the diagnostic refers to.
+  uint32_t offset;
+  std::vector<std::string> arguments;
+
+  // Message without the location.
+  std::string message() const;
+
+  friend std::ostream& operator<<(std::ostream& os, const Diagnostic& diagnostic) {
+    return os << diagnostic.message();
+  }
+};
+
+// Collects the diagnostics and renders them together with their location and the surrounding lines.
+class DiagnosticsEngine {
+public:
+  // The source manager must outlive the engine.
+  explicit DiagnosticsEngine(const SourceManager& source_manager);
+
+  void report(Diagnostic diagnostic);
+  const std::vector<Diagnostic>& diagnostics() const;
+
+  std::string render(const Diagnostic& diagnostic) const;
+
+private:
+  // Number of lines printed before and after the line of the diagnostic.
+  static constexpr int kContextLines = 2;
+
+  const SourceManager& source_manager_;
+  std::vector<Diagnostic> diagnostics_;
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__DIAGNOSTICS_H
@@ -0,0 +1,39 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__ERROR_STORE_H
+#define PASCAL_COMPILER_TUTORIAL__ERROR_STORE_H
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "result.h"
+
+namespace freezing::interpreter {
+
+// Handle to an error recorded in an ErrorStore.
+struct ErrorId {
+  uint32_t index;
+};
+
+// Errors recorded while compiling or running a single program.
+// Hot paths return an ErrorId instead of the error, so their Results are hardly larger than the values, and
+// forwarding an error up the stack copies an int rather than the error's strings. The error is looked up only
+// when it's reported.
+template<typename E>
+class ErrorStore {
+public:
+  Error<ErrorId> add(E error) {
+    errors_.push_back(std::move(error));
+    return make_error(ErrorId{static_cast<uint32_t>(errors_.size() - 1)});
+  }
+
+  const E& get(ErrorId error_id) const {
+    assert(error_id.index < errors_.size());
+    return errors_[error_id.index];
+  }
+
+private:
+  std::vector<E> errors_;
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__ERROR_STORE_H
@@ -0,0 +1,26 @@
+PROGRAM Part12;
+VAR
+   a : INTEGER;
+
+PROCEDURE P1(f, d: INTEGER; l: REAL);
+VAR
+   b : REAL;
+   k : REAL;
+
+   PROCEDURE P2(c, d: INTEGER; e, f, g: REAL);
+   VAR
+      z : REAL;
+   BEGIN {P2}
+      z := 777.5;
+   END;  {P2}
+
+BEGIN {P1}
+  k := f + d - l;
+  b := 300.3;
+  P2(30, 20 + d, 10.35 - b, b * b, k + b - f * (d + l));
+END;  {P1}
+
+BEGIN {Part12}
+   a := 10;
+   P1(a + 10, a * a, 33.5 + 22);
+END.  {Part12}
@@ -0,0 +1,6 @@
+PROGRAM Simple1;
+VAR
+  a: INTEGER;
+BEGIN
+  a := 10;
+END.
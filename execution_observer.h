@@ -0,0 +1,40 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__EXECUTION_OBSERVER_H
+#define PASCAL_COMPILER_TUTORIAL__EXECUTION_OBSERVER_H
+
+#include <iostream>
+#include "stack_frame.h"
+
+namespace freezing::interpreter {
+
+// Receives execution events from the interpreter, in both execution modes.
+// Frames passed to the hooks are only valid for the duration of the call.
+class ExecutionObserver {
+public:
+  virtual ~ExecutionObserver() = default;
+
+  // Invoked after the frame is pushed and the arguments are bound to the formal parameters.
+  virtual void on_call(const StackFrame& /*frame*/) {}
+
+  // Invoked right before the frame is released.
+  virtual void on_return(const StackFrame& /*frame*/) {}
+
+  // Invoked after the value is stored into the slot of the given frame.
+  virtual void on_assign(const StackFrame& /*frame*/, int /*slot*/, const DataType& /*value*/) {}
+};
+
+// Dumps every frame when it is about to be released.
+class StackFrameDumpObserver : public ExecutionObserver {
+public:
+  explicit StackFrameDumpObserver(std::ostream& os = std::cout) : os_{os} {}
+
+  void on_return(const StackFrame& frame) override {
+    os_ << frame << '\n';
+  }
+
+private:
+  std::ostream& os_;
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__EXECUTION_OBSERVER_H
@@ -0,0 +1,153 @@
+#include <cassert>
+#include "flat_ast.h"
+#include "ast_visitor.h"
+
+namespace freezing::interpreter {
+
+FlatAst::FlatAst(NodeId root)
+    : root_{root}, kinds_(root + 1, AstNodeKind::NONE), token_types_(root + 1, TokenType::END_OF_FILE),
+      payloads_(root + 1), first_child_(root + 1), num_children_(root + 1) {
+  // Every node except the root is a child of exactly one node.
+  children_.reserve(root);
+}
+
+FlatAst FlatAst::create(const Program& program) {
+  // Program node is created last by the parser, so its id is the largest one, unless blocks were parsed lazily.
+  FlatAst ast{program.id};
+
+  AstVisitorCallbacks callbacks{};
+  callbacks.program_post = [&ast](const Program& program) {
+    ast.add_node(program.id, AstNodeKind::PROGRAM, {program.block.id});
+    ast.payloads_[program.id] = program.name.id();
+  };
+  callbacks.block = [&ast](const Block& block) {
+    ast.add_node(block.id, AstNodeKind::BLOCK);
+    for (const auto& var_decl : block.variable_declarations) {
+      ast.add_child(block.id, var_decl.id);
+    }
+    for (const auto& procedure_decl : block.procedure_declarations) {
+      ast.add_child(block.id, procedure_decl.id);
+    }
+    ast.add_child(block.id, block.compound_statement.id);
+  };
+  callbacks.var_decl_post = [&ast](const VarDecl& var_decl) {
+    ast.add_node(var_decl.id, AstNodeKind::VAR_DECL);
+    for (const auto& variable : var_decl.variables) {
+      ast.add_child(var_decl.id, variable.id);
+    }
+    ast.token_types_[var_decl.id] = var_decl.type_specification;
+  };
+  callbacks.procedure_decl_post = [&ast](const ProcedureDecl& procedure_decl) {
+    ast.add_node(procedure_decl.id, AstNodeKind::PROCEDURE_DECL);
+    for (const auto& param : procedure_decl.parameters) {
+      ast.add_child(procedure_decl.id, param.id);
+    }
+    if (const Block* block = procedure_decl.block->parsed()) {
+      ast.add_child(procedure_decl.id, block->id);
+    }
+    ast.payloads_[procedure_decl.id] = procedure_decl.name.id();
+  };
+  callbacks.param = [&ast](const Param& param) {
+    ast.add_node(param.id, AstNodeKind::PARAM);
+    ast.token_types_[param.id] = param.type_specification;
+    ast.payloads_[param.id] = param.identifier.id();
+  };
+  callbacks.compound_statement = [&ast](const CompoundStatement& compound_statement) {
+    ast.add_node(compound_statement.id, AstNodeKind::COMPOUND_STATEMENT);
+    for (const auto& statement : compound_statement.statements) {
+      ast.add_child(compound_statement.id, node_id(statement));
+    }
+  };
+  callbacks.assignment_statement = [&ast](const AssignmentStatement& assignment_statement) {
+    ast.add_node(assignment_statement.id, AstNodeKind::ASSIGNMENT_STATEMENT,
+                 {assignment_statement.variable.id, node_id(assignment_statement.expression)});
+  };
+  callbacks.procedure_call_post = [&ast](const ProcedureCall& procedure_call) {
+    ast.add_node(procedure_call.id, AstNodeKind::PROCEDURE_CALL);
+    for (const auto& argument : procedure_call.parameters) {
+      ast.add_child(procedure_call.id, node_id(argument));
+    }
+    ast.payloads_[procedure_call.id] = procedure_call.name.id();
+  };
+  callbacks.unary_op = [&ast](const UnaryOp& unary_op) {
+    ast.add_node(unary_op.id, AstNodeKind::UNARY_OP, {node_id(*unary_op.node)});
+    ast.token_types_[unary_op.id] = unary_op.op_type;
+  };
+  callbacks.bin_op = [&ast](const BinOp& bin_op) {
+    ast.add_node(bin_op.id, AstNodeKind::BIN_OP, {node_id(*bin_op.left), node_id(*bin_op.right)});
+    ast.token_types_[bin_op.id] = bin_op.op_type;
+  };
+  callbacks.variable = [&ast](const Variable& variable) {
+    ast.add_node(variable.id, AstNodeKind::VARIABLE);
+    ast.payloads_[variable.id] = variable.name.id();
+  };
+  callbacks.num = [&ast](const Num& num) {
+    ast.add_node(num.id, AstNodeKind::NUM);
+    ast.payloads_[num.id] = ast.literals_.size();
+    ast.literals_.push_back(num.value);
+  };
+  callbacks.empty = [&ast](const Empty& empty) {
+    ast.add_node(empty.id, AstNodeKind::EMPTY);
+  };
+
+  AstVisitorFn{callbacks}.visit(program);
+  return ast;
+}
+
+NodeId FlatAst::root() const {
+  return root_;
+}
+
+AstNodeKind FlatAst::kind(NodeId node_id) const {
+  return kinds_[node_id];
+}
+
+TokenType FlatAst::token_type(NodeId node_id) const {
+  return token_types_[node_id];
+}
+
+Identifier FlatAst::name(NodeId node_id) const {
+  assert(kinds_[node_id] != AstNodeKind::NUM);
+  return Identifier::from_id(payloads_[node_id]);
+}
+
+const NumType& FlatAst::value(NodeId node_id) const {
+  assert(kinds_[node_id] == AstNodeKind::NUM);
+  return literals_[payloads_[node_id]];
+}
+
+int FlatAst::num_children(NodeId node_id) const {
+  return num_children_[node_id];
+}
+
+const NodeId* FlatAst::children_begin(NodeId node_id) const {
+  return children_.data() + first_child_[node_id];
+}
+
+const NodeId* FlatAst::children_end(NodeId node_id) const {
+  return children_begin(node_id) + num_children_[node_id];
+}
+
+void FlatAst::add_node(NodeId node_id, AstNodeKind kind, std::initializer_list<NodeId> children) {
+  // Nodes of the lazily parsed blocks have larger ids than the program.
+  if (node_id >= static_cast<NodeId>(kinds_.size())) {
+    kinds_.resize(node_id + 1, AstNodeKind::NONE);
+    token_types_.resize(node_id + 1, TokenType::END_OF_FILE);
+    payloads_.resize(node_id + 1);
+    first_child_.resize(node_id + 1);
+    num_children_.resize(node_id + 1);
+  }
+  kinds_[node_id] = kind;
+  first_child_[node_id] = children_.size();
+  for (NodeId child_id : children) {
+    add_child(node_id, child_id);
+  }
+}
+
+void FlatAst::add_child(NodeId node_id, NodeId child_id) {
+  assert(first_child_[node_id] + num_children_[node_id] == children_.size() && "Children must be added together.");
+  children_.push_back(child_id);
+  num_children_[node_id]++;
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__FLAT_AST_H
+#define PASCAL_COMPILER_TUTORIAL__FLAT_AST_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include "ast.h"
+
+namespace freezing::interpreter {
+
+enum class AstNodeKind : uint8_t {
+  // Id that no node of the tree has, e.g. the id of a node that the incremental parser replaced.
+  NONE,
+  PROGRAM,
+  BLOCK,
+  VAR_DECL,
+  PROCEDURE_DECL,
+  PARAM,
+  COMPOUND_STATEMENT,
+  ASSIGNMENT_STATEMENT,
+  PROCEDURE_CALL,
+  BIN_OP,
+  UNARY_OP,
+  VARIABLE,
+  NUM,
+  EMPTY,
+};
+
+// Structure of arrays representation of the AST. Node ids are dense, so every property of the node is stored in
+// a contiguous array indexed by its NodeId, and whole program passes scan memory linearly instead of chasing
+// pointers between variants. Blocks that weren't parsed yet aren't part of it.
+//
+// Children of the node, in the same order as they appear in the Program:
+//    PROGRAM: block
+//    BLOCK: variable declarations, procedure declarations, compound statement
+//    VAR_DECL: variables
+//    PROCEDURE_DECL: parameters, block (if it's parsed)
+//    COMPOUND_STATEMENT: statements
+//    ASSIGNMENT_STATEMENT: variable, expression
+//    PROCEDURE_CALL: arguments
+//    BIN_OP: left, right
+//    UNARY_OP: operand
+class FlatAst {
+public:
+  static FlatAst create(const Program& program);
+
+  NodeId root() const;
+
+  AstNodeKind kind(NodeId node_id) const;
+  // Operator of BIN_OP and UNARY_OP, type specification of VAR_DECL and PARAM.
+  TokenType token_type(NodeId node_id) const;
+  // Name of PROGRAM, PROCEDURE_DECL, PARAM, VARIABLE and PROCEDURE_CALL.
+  Identifier name(NodeId node_id) const;
+  // Value of NUM.
+  const NumType& value(NodeId node_id) const;
+
+  int num_children(NodeId node_id) const;
+  const NodeId* children_begin(NodeId node_id) const;
+  const NodeId* children_end(NodeId node_id) const;
+
+private:
+  NodeId root_;
+  std::vector<AstNodeKind> kinds_;
+  std::vector<TokenType> token_types_;
+  // Id of the name, or the index into literals_ for NUM.
+  std::vector<uint32_t> payloads_;
+  // Children of the node are children_[first_child_[id], first_child_[id] + num_children_[id]).
+  std::vector<uint32_t> first_child_;
+  std::vector<uint32_t> num_children_;
+  std::vector<NodeId> children_;
+  std::vector<NumType> literals_;
+
+  explicit FlatAst(NodeId root);
+
+  void add_node(NodeId node_id, AstNodeKind kind, std::initializer_list<NodeId> children = {});
+  void add_child(NodeId node_id, NodeId child_id);
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__FLAT_AST_H
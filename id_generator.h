@@ -9,11 +9,17 @@ template<typename T>
 class IdGenerator {
 public:
   IdGenerator() : next_id{} {}
-  
+  explicit IdGenerator(T first_id) : next_id{first_id} {}
+
   T next() {
     return next_id++;
   }
 
+  // Returns the id that next() returns, without generating it.
+  T peek() const {
+    return next_id;
+  }
+
 private:
   T next_id;
 };
@@ -0,0 +1,119 @@
+#include "identifier.h"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+// Texts of the interned identifiers, indexed by id. Interning locks only the shard that the hash of the text selects,
+// so the lexers of the parallel chunks rarely wait for each other. Texts are kept in blocks that never move, so they
+// are read without locking.
+class IdentifierTable {
+public:
+  IdentifierTable() {
+    intern("", std::hash<std::string_view>{}(""));
+  }
+
+  uint32_t intern(std::string_view text, size_t hash) {
+    Shard& shard = shards_[hash % kNumShards];
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    auto it = shard.ids.find(text);
+    if (it != shard.ids.end()) {
+      return it->second;
+    }
+    uint32_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    assert(id < kMaxNumBlocks * kBlockSize && "Too many distinct identifiers.");
+    // Strings in a deque never move, and neither do the characters they own.
+    std::string_view stored_text = shard.texts.emplace_back(text);
+    block(id)[id % kBlockSize] = stored_text;
+    shard.ids.emplace(stored_text, id);
+    return id;
+  }
+
+  // The id must have been interned before, by this thread or by one that synchronized with it since.
+  std::string_view text(uint32_t id) const {
+    return blocks_[id / kBlockSize].load(std::memory_order_acquire)[id % kBlockSize];
+  }
+
+private:
+  static constexpr int kNumShards = 16;
+  static constexpr uint32_t kBlockSize = 1 << 14;
+  static constexpr uint32_t kMaxNumBlocks = 1 << 14;
+
+  struct Shard {
+    std::mutex mutex;
+    // Keys point into the texts.
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::deque<std::string> texts;
+  };
+
+  std::array<Shard, kNumShards> shards_;
+  std::atomic<uint32_t> next_id_{0};
+  std::atomic<std::string_view*> blocks_[kMaxNumBlocks] = {};
+
+  std::string_view* block(uint32_t id) {
+    auto& block_pointer = blocks_[id / kBlockSize];
+    std::string_view* block = block_pointer.load(std::memory_order_acquire);
+    if (block == nullptr) {
+      // Ids of a block are interned under different shard locks, so the first ones may race to allocate it.
+      auto* new_block = new std::string_view[kBlockSize];
+      if (block_pointer.compare_exchange_strong(block, new_block, std::memory_order_acq_rel)) {
+        block = new_block;
+      } else {
+        delete[] new_block;
+      }
+    }
+    return block;
+  }
+};
+
+// Never destroyed, since identifiers may be printed by the destructors of other static objects.
+IdentifierTable& identifier_table() {
+  static auto* table = new IdentifierTable{};
+  return *table;
+}
+
+// Most identifiers repeat many times in a source, so each thread remembers the recent ones and interns them again
+// without locking.
+struct CachedIdentifier {
+  size_t hash;
+  uint32_t id;
+  std::string_view text;
+};
+
+constexpr size_t kIdentifierCacheSize = 256;
+
+}
+
+Identifier::Identifier(std::string_view text) {
+  thread_local std::array<detail::CachedIdentifier, detail::kIdentifierCacheSize> cache{};
+  size_t hash = std::hash<std::string_view>{}(text);
+  auto& cached = cache[hash % detail::kIdentifierCacheSize];
+  // Empty entries match only the empty text, whose id is 0.
+  if (cached.hash == hash && cached.text == text) {
+    id_ = cached.id;
+    return;
+  }
+  auto& table = detail::identifier_table();
+  id_ = table.intern(text, hash);
+  cached = detail::CachedIdentifier{hash, id_, table.text(id_)};
+}
+
+Identifier Identifier::from_id(uint32_t id) {
+  Identifier identifier{};
+  identifier.id_ = id;
+  return identifier;
+}
+
+std::string_view Identifier::text() const {
+  return detail::identifier_table().text(id_);
+}
+
+}
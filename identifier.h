@@ -0,0 +1,73 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__IDENTIFIER_H
+#define PASCAL_COMPILER_TUTORIAL__IDENTIFIER_H
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string_view>
+#include <fmt/format.h>
+
+namespace freezing::interpreter {
+
+// Name interned in the process wide identifier table, so that equal names have equal ids and are compared as integers.
+// The lexer interns the names of ID tokens, so the later phases only carry the ids, and the text is recovered only for
+// diagnostics and output. Ids are dense and never released. Interning is thread safe.
+class Identifier {
+public:
+  // The empty name, whose id is 0.
+  Identifier() = default;
+  explicit Identifier(std::string_view text);
+
+  // Identifier with an id that was interned before, e.g. the one stored in a token.
+  static Identifier from_id(uint32_t id);
+
+  uint32_t id() const {
+    return id_;
+  }
+
+  // Points into the table, so it's valid until the end of the process.
+  std::string_view text() const;
+
+  bool empty() const {
+    return id_ == 0;
+  }
+
+  friend bool operator==(Identifier a, Identifier b) {
+    return a.id_ == b.id_;
+  }
+
+  friend bool operator!=(Identifier a, Identifier b) {
+    return a.id_ != b.id_;
+  }
+
+  // Orders by id, i.e. by the time of interning, not alphabetically.
+  friend bool operator<(Identifier a, Identifier b) {
+    return a.id_ < b.id_;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, Identifier identifier) {
+    return os << identifier.text();
+  }
+
+private:
+  uint32_t id_ = 0;
+};
+
+}
+
+template<>
+struct std::hash<freezing::interpreter::Identifier> {
+  size_t operator()(freezing::interpreter::Identifier identifier) const {
+    return identifier.id();
+  }
+};
+
+template<>
+struct fmt::formatter<freezing::interpreter::Identifier> : fmt::formatter<std::string_view> {
+  template<typename FormatContext>
+  auto format(freezing::interpreter::Identifier identifier, FormatContext& ctx) {
+    return fmt::formatter<std::string_view>::format(identifier.text(), ctx);
+  }
+};
+
+#endif //PASCAL_COMPILER_TUTORIAL__IDENTIFIER_H
@@ -0,0 +1,244 @@
+#include "incremental_parser.h"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+#include <utility>
+#include "parallel_lexer.h"
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+bool is_lexically_equal(const Token& a, std::string_view a_text, const Token& b, std::string_view b_text) {
+  return a.token_type == b.token_type && a.lexeme(a_text) == b.lexeme(b_text);
+}
+
+}
+
+IncrementalParser::IncrementalParser(SourceId source_id, std::string text)
+    : source_id_{source_id}, text_{std::move(text)}, node_id_generator_{}, num_unused_node_ids_{0},
+      last_change_{ProgramChange::WHOLE_PROGRAM}, reparsed_procedure_{nullptr} {}
+
+Result<const Program*, ParserErrorsT> IncrementalParser::parse() {
+  last_change_ = ProgramChange::WHOLE_PROGRAM;
+  auto tokens = lex_parallel(text_, source_id_, num_lexer_chunks(text_));
+  if (!tokens) {
+    tokens_.clear();
+    program_.reset();
+    return make_error(ParserErrorsT{std::move(tokens.error())});
+  }
+  tokens_ = std::move(*tokens);
+  return parse_tokens();
+}
+
+Result<const Program*, ParserErrorsT> IncrementalParser::apply(const TextEdit& edit) {
+  assert(edit.offset >= 0 && edit.removed_length >= 0
+         && edit.offset + edit.removed_length <= static_cast<int>(text_.size()));
+  previous_text_.assign(text_, 0, edit.offset);
+  previous_text_.append(edit.inserted_text);
+  previous_text_.append(text_, edit.offset + edit.removed_length);
+  std::swap(text_, previous_text_);
+  last_change_ = ProgramChange::WHOLE_PROGRAM;
+
+  if (tokens_.empty()) {
+    return parse();
+  }
+  auto token_edit = relex(edit);
+  if (!token_edit) {
+    tokens_.clear();
+    program_.reset();
+    return make_error(ParserErrorsT{std::move(token_edit.error())});
+  }
+  if (program_ && token_edit->is_lexically_equal) {
+    last_change_ = ProgramChange::NONE;
+    return &*program_;
+  }
+  if (program_ && reparse_procedure(*token_edit) && num_unused_node_ids_ <= program_->id + 1 - num_unused_node_ids_) {
+    last_change_ = ProgramChange::PROCEDURE;
+    return &*program_;
+  }
+  return parse_tokens();
+}
+
+ProgramChange IncrementalParser::last_change() const {
+  return last_change_;
+}
+
+const ProcedureDecl* IncrementalParser::reparsed_procedure() const {
+  return last_change_ == ProgramChange::PROCEDURE ? reparsed_procedure_ : nullptr;
+}
+
+std::string_view IncrementalParser::text() const {
+  return text_;
+}
+
+const std::vector<Token>& IncrementalParser::tokens() const {
+  return tokens_;
+}
+
+Result<const Program*, ParserErrorsT> IncrementalParser::parse_tokens() {
+  int max_num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  Parser parser{text_, source_id_, TokenStream{tokens_.data(), static_cast<int>(tokens_.size()), 0}, max_num_threads};
+  auto program = parser.parse_program();
+  if (!program) {
+    program_.reset();
+    procedure_spans_.clear();
+    return make_error(parser.error(program.error()));
+  }
+  program_.emplace(std::move(*program));
+  node_id_generator_ = IdGenerator<NodeId>{program_->id + 1};
+  num_unused_node_ids_ = 0;
+  find_procedure_spans();
+  return &*program_;
+}
+
+LexerResult<IncrementalParser::TokenEdit> IncrementalParser::relex(const TextEdit& edit) {
+  int delta = static_cast<int>(edit.inserted_text.size()) - edit.removed_length;
+  int inserted_end = edit.offset + static_cast<int>(edit.inserted_text.size());
+  // The lexer looks at most one character past the end of a token, so the tokens that end before the edit are
+  // unchanged, and lexing restarts right after the last one of them.
+  int begin = std::partition_point(tokens_.begin(), tokens_.end(), [&edit](const Token& token) {
+    return static_cast<int>(token.offset + token.length) < edit.offset;
+  }) - tokens_.begin();
+  int pos = 0;
+  CharLocation location{0, 0};
+  if (begin > 0) {
+    const Token& previous = tokens_[begin - 1];
+    pos = static_cast<int>(previous.offset + previous.length);
+    // Columns of the tokens are one past the column of their first character.
+    location = previous.location();
+    location.column_number += static_cast<int>(previous.length) - 1;
+  }
+
+  Lexer lexer{text_, source_id_, pos, location};
+  std::vector<Token> new_tokens;
+  int old_end = begin;
+  while (true) {
+    auto advance_check = lexer.advance();
+    if (!advance_check) {
+      return forward_error(std::move(advance_check));
+    }
+    const Token& token = lexer.peek();
+    // Past the edit the text is unchanged, so once a token starts where an old one did, the rest of them are the same.
+    // END_OF_FILE always does.
+    if (static_cast<int>(token.offset) >= inserted_end) {
+      int old_offset = static_cast<int>(token.offset) - delta;
+      while (static_cast<int>(tokens_[old_end].offset) < old_offset) {
+        old_end++;
+      }
+      if (static_cast<int>(tokens_[old_end].offset) == old_offset) {
+        break;
+      }
+    }
+    new_tokens.push_back(token);
+  }
+
+  int num_old_tokens = old_end - begin;
+  int num_new_tokens = static_cast<int>(new_tokens.size());
+  bool is_lexically_equal = num_old_tokens == num_new_tokens;
+  for (int i = 0; i < num_new_tokens && is_lexically_equal; i++) {
+    is_lexically_equal = detail::is_lexically_equal(new_tokens[i], text_, tokens_[begin + i], previous_text_);
+  }
+
+  // Tokens after the edit only move. Those on the line where the old and the new tokens meet also move within it.
+  CharLocation old_location = tokens_[old_end].location();
+  CharLocation new_location = lexer.peek().location();
+  int line_delta = new_location.line_number - old_location.line_number;
+  int column_delta = new_location.column_number - old_location.column_number;
+  int num_tokens = static_cast<int>(tokens_.size());
+  int first_moved_line = old_end;
+  for (; first_moved_line < num_tokens; first_moved_line++) {
+    CharLocation token_location = tokens_[first_moved_line].location();
+    if (token_location.line_number != old_location.line_number) {
+      break;
+    }
+    tokens_[first_moved_line].packed_location =
+        PackedCharLocation{CharLocation{new_location.line_number, token_location.column_number + column_delta}};
+  }
+  for (int i = old_end; i < first_moved_line; i++) {
+    tokens_[i].offset += delta;
+  }
+  // Separate loops for the common edits that keep the lines, each of them simple enough to be vectorized.
+  if (line_delta == 0) {
+    for (int i = first_moved_line; i < num_tokens; i++) {
+      tokens_[i].offset += delta;
+    }
+  } else {
+    for (int i = first_moved_line; i < num_tokens; i++) {
+      tokens_[i].offset += delta;
+      tokens_[i].packed_location.add_lines(line_delta);
+    }
+  }
+
+  if (num_new_tokens > num_old_tokens) {
+    tokens_.insert(tokens_.begin() + old_end, num_new_tokens - num_old_tokens, Token{});
+  } else {
+    tokens_.erase(tokens_.begin() + begin + num_new_tokens, tokens_.begin() + old_end);
+  }
+  std::copy(new_tokens.begin(), new_tokens.end(), tokens_.begin() + begin);
+  return TokenEdit{begin, old_end, begin + num_new_tokens, is_lexically_equal};
+}
+
+bool IncrementalParser::reparse_procedure(const TokenEdit& token_edit) {
+  // Last declaration that starts at or before the edit, which must also end after it.
+  auto span_it = std::upper_bound(procedure_spans_.begin(), procedure_spans_.end(), token_edit.begin,
+                                  [](int index, const ProcedureSpan& span) { return index < span.begin; });
+  if (span_it == procedure_spans_.begin() || token_edit.old_end > std::prev(span_it)->end) {
+    return false;
+  }
+  --span_it;
+
+  int token_delta = token_edit.new_end - token_edit.old_end;
+  int end = span_it->end + token_delta;
+  NodeId first_node_id = node_id_generator_.peek();
+  Parser parser{text_, source_id_, TokenStream{tokens_.data(), static_cast<int>(tokens_.size()), span_it->begin}, 1};
+  parser.node_id_generator = node_id_generator_;
+  auto procedure_declaration = parser.parse_procedure_declaration();
+  // Tokens after the declaration are the same as before, so if it still ends where they start, the rest of the program
+  // parses as before.
+  if (!procedure_declaration || parser.tokens_.index() != end) {
+    return false;
+  }
+
+  auto& declaration = program_->block.procedure_declarations[span_it - procedure_spans_.begin()];
+  // The replaced nodes stay in the arena until the program is parsed from scratch.
+  num_unused_node_ids_ += declaration.id - span_it->first_node_id + 1;
+  declaration = std::move(*procedure_declaration);
+  reparsed_procedure_ = &declaration;
+  program_->arena.adopt(std::move(parser.arena_));
+  node_id_generator_ = parser.node_id_generator;
+  // Program node keeps the largest id.
+  num_unused_node_ids_++;
+  program_->id = node_id_generator_.next();
+
+  *span_it = ProcedureSpan{span_it->begin, end, first_node_id};
+  for (auto it = std::next(span_it); it != procedure_spans_.end(); ++it) {
+    it->begin += token_delta;
+    it->end += token_delta;
+  }
+  return true;
+}
+
+void IncrementalParser::find_procedure_spans() {
+  procedure_spans_.clear();
+  const Block& block = program_->block;
+  if (block.procedure_declarations.empty()) {
+    return;
+  }
+  // Top level declarations follow the variable declarations, which don't have any PROCEDURE tokens.
+  int begin = std::find_if(tokens_.begin(), tokens_.end(), [](const Token& token) {
+    return token.token_type == TokenType::PROCEDURE;
+  }) - tokens_.begin();
+  auto ends = detail::find_procedure_declaration_ends(tokens_.data(), static_cast<int>(tokens_.size()), begin);
+  assert(ends.size() == block.procedure_declarations.size() && "The program was parsed from the same tokens.");
+  // Nodes are numbered in source order, and each declaration after all of its nodes.
+  NodeId first_node_id = block.variable_declarations.empty() ? 0 : block.variable_declarations.back().id + 1;
+  for (size_t i = 0; i < ends.size(); i++) {
+    procedure_spans_.push_back(ProcedureSpan{begin, ends[i], first_node_id});
+    begin = ends[i];
+    first_node_id = block.procedure_declarations[i].id + 1;
+  }
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__INCREMENTAL_PARSER_H
+#define PASCAL_COMPILER_TUTORIAL__INCREMENTAL_PARSER_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ast.h"
+#include "id_generator.h"
+#include "parser.h"
+#include "result.h"
+#include "token.h"
+
+namespace freezing::interpreter {
+
+// Replaces text[offset, offset + removed_length) with the inserted text.
+struct TextEdit {
+  int offset;
+  int removed_length;
+  std::string inserted_text;
+};
+
+// How the last parse or edit changed the program.
+enum class ProgramChange { NONE, PROCEDURE, WHOLE_PROGRAM };
+
+// Keeps the tokens and the program of a source that is being edited up to date. An edit re-lexes only the tokens
+// around it, and if they are all within a single top level procedure declaration, only that declaration is re-parsed.
+// The rest of the program, including the node ids, is kept. The whole program is parsed again otherwise.
+//
+// The parser owns the text, so the offsets of the tokens and the diagnostics refer to text(), not to the source the
+// parser was created from.
+class IncrementalParser {
+public:
+  IncrementalParser(SourceId source_id, std::string text);
+  IncrementalParser(const IncrementalParser&) = delete;
+  IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+  // Lexes and parses the whole text.
+  Result<const Program*, ParserErrorsT> parse();
+  // Applies the edit to the text and brings the program up to date. Edits may follow one another even if the text
+  // can't be parsed in between. The program is valid until the next call to parse() or apply().
+  Result<const Program*, ParserErrorsT> apply(const TextEdit& edit);
+
+  ProgramChange last_change() const;
+  // Top level declaration that the last apply() re-parsed, if the last change is PROCEDURE.
+  const ProcedureDecl* reparsed_procedure() const;
+
+  std::string_view text() const;
+  // Empty if the text couldn't be lexed.
+  const std::vector<Token>& tokens() const;
+
+private:
+  // Tokens [begin, end) of a top level procedure declaration, whose nodes have ids [first_node_id, declaration id].
+  struct ProcedureSpan {
+    int begin;
+    int end;
+    NodeId first_node_id;
+  };
+
+  // Old tokens [begin, old_end) were replaced by the new tokens [begin, new_end).
+  struct TokenEdit {
+    int begin;
+    int old_end;
+    int new_end;
+    // New tokens have the same types and lexemes as the old ones, e.g. when only a comment was edited.
+    bool is_lexically_equal;
+  };
+
+  SourceId source_id_;
+  std::string text_;
+  // Text before the last edit, whose memory is reused for the text after the next one.
+  std::string previous_text_;
+  std::vector<Token> tokens_;
+  // Null if the text couldn't be parsed.
+  std::optional<Program> program_;
+  std::vector<ProcedureSpan> procedure_spans_;
+  // Re-parsed declarations are numbered after all the other nodes, and the program gets a new id after them.
+  IdGenerator<NodeId> node_id_generator_;
+  // Ids of the nodes that were replaced. Once they outnumber the ids in use, the program is parsed from scratch, which
+  // numbers the nodes densely again and releases the replaced nodes.
+  int num_unused_node_ids_;
+  ProgramChange last_change_;
+  const ProcedureDecl* reparsed_procedure_;
+
+  // Parses the whole program from the current tokens.
+  Result<const Program*, ParserErrorsT> parse_tokens();
+  // Re-lexes the tokens that the edit may have changed, the edit must be already applied to the text.
+  LexerResult<TokenEdit> relex(const TextEdit& edit);
+  // Re-parses the declaration that encloses the token edit. Returns false if there isn't one, or if it no longer
+  // parses into a single declaration, in which case the whole program has to be parsed.
+  bool reparse_procedure(const TokenEdit& token_edit);
+  // Finds the spans of the top level declarations of the program that was just parsed.
+  void find_procedure_spans();
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__INCREMENTAL_PARSER_H
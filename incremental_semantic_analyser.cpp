@@ -0,0 +1,183 @@
+#include "incremental_semantic_analyser.h"
+
+#include <cassert>
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+std::vector<TokenType> parameter_types_of(const ProcedureDecl& procedure_decl) {
+  std::vector<TokenType> parameter_types;
+  for (const auto& param : procedure_decl.parameters) {
+    parameter_types.push_back(param.type_specification);
+  }
+  return parameter_types;
+}
+
+// Resets the entries of the symbol references to the ones of the unanalysed nodes, since the analysis doesn't set
+// them for the references that can't be resolved.
+AstVisitorCallbacks make_reset_callbacks(SemanticModel& semantic_model) {
+  AstVisitorCallbacks callbacks{};
+  callbacks.variable = [&semantic_model](const Variable& variable) {
+    semantic_model.addresses[variable.id] = LexicalAddress{-1, -1};
+    semantic_model.expression_types[variable.id] = ValueType::INTEGER;
+  };
+  callbacks.procedure_call_post = [&semantic_model](const ProcedureCall& procedure_call) {
+    semantic_model.addresses[procedure_call.id] = LexicalAddress{-1, -1};
+    semantic_model.call_targets[procedure_call.id] = nullptr;
+  };
+  return callbacks;
+}
+
+}
+
+Result<const SemanticModel*, std::vector<SemanticAnalysisError>> IncrementalSemanticAnalyser::analyse(
+    const Program& program) {
+  const Block& block = program.block;
+  int num_procedures = static_cast<int>(block.procedure_declarations.size());
+  semantic_model_ = SemanticModel{};
+  num_unused_scopes_ = 0;
+  program_name_ = program.name;
+  declarations_.clear();
+  declarations_.resize(num_procedures + 1);
+  procedure_indices_.clear();
+  for (int i = 0; i < num_procedures; i++) {
+    procedure_indices_.emplace(block.procedure_declarations[i].name, i);
+  }
+
+  detail::reserve_node_ids(semantic_model_, program.id);
+  // A single traversal state for all the declarations, so that they are analysed exactly as by the SemanticAnalyser.
+  detail::AnalysisState state{semantic_model_, -1, {}};
+  AstVisitorFn visitor{detail::make_analysis_callbacks(state)};
+  std::invoke(visitor.callbacks.program_pre, program);
+  for (const auto& var_decl : block.variable_declarations) {
+    visitor.visit(var_decl);
+  }
+  variable_declaration_errors_ = std::move(state.errors);
+  state.errors.clear();
+  for (int i = 0; i <= num_procedures; i++) {
+    analyse_declaration(visitor, state, block, i, false);
+  }
+
+  is_analysed_ = true;
+  return result();
+}
+
+Result<const SemanticModel*, std::vector<SemanticAnalysisError>> IncrementalSemanticAnalyser::reanalyse(
+    const Program& program, const std::vector<const ProcedureDecl*>& changed_procedures) {
+  const Block& block = program.block;
+  int num_procedures = static_cast<int>(block.procedure_declarations.size());
+  if (!is_analysed_ || program.name != program_name_ || static_cast<int>(declarations_.size()) != num_procedures + 1
+      || static_cast<int>(procedure_indices_.size()) != num_procedures || !semantic_model_.unanalysed_blocks.empty()
+      || 2 * num_unused_scopes_ > static_cast<int>(semantic_model_.scopes.size())) {
+    return analyse(program);
+  }
+  assert(program.deferred_parser == nullptr);
+  auto& program_scope = semantic_model_.scopes.front();
+
+  std::vector<bool> is_reanalysed(num_procedures + 1, false);
+  // Headers whose signature changed, with the index of the declaration they belong to.
+  std::vector<std::pair<Identifier, int>> changed_headers;
+  for (const ProcedureDecl* procedure_decl : changed_procedures) {
+    int index = static_cast<int>(procedure_decl - block.procedure_declarations.data());
+    assert(index >= 0 && index < num_procedures && "Changed procedures are top level declarations of the program.");
+    is_reanalysed[index] = true;
+    Declaration& declaration = declarations_[index];
+    auto parameter_types = detail::parameter_types_of(*procedure_decl);
+    if (procedure_decl->name == declaration.name && parameter_types == declaration.parameter_types) {
+      continue;
+    }
+    changed_headers.emplace_back(declaration.name, index);
+    if (procedure_decl->name != declaration.name) {
+      // Renamed to the name of another procedure.
+      if (procedure_indices_.count(procedure_decl->name) > 0) {
+        return analyse(program);
+      }
+      procedure_indices_.erase(declaration.name);
+      procedure_indices_.emplace(procedure_decl->name, index);
+      if (declaration.dependencies.defines_header) {
+        program_scope.erase(declaration.name);
+        declaration.dependencies.defines_header = false;
+      }
+      changed_headers.emplace_back(procedure_decl->name, index);
+    }
+  }
+  // Only the declarations after a procedure can see its header.
+  for (const auto&[name, index] : changed_headers) {
+    for (int i = index + 1; i <= num_procedures; i++) {
+      if (declarations_[i].dependencies.program_scope_lookups.count(name) > 0) {
+        is_reanalysed[i] = true;
+      }
+    }
+  }
+
+  for (int i = 0; i <= num_procedures; i++) {
+    if (!is_reanalysed[i]) {
+      continue;
+    }
+    // Replaced scopes keep their ids, but release their symbols.
+    for (ScopeId scope : declarations_[i].dependencies.scopes) {
+      semantic_model_.scopes[scope] = SymbolTable{};
+      semantic_model_.parent_scopes[scope] = -1;
+    }
+    num_unused_scopes_ += static_cast<int>(declarations_[i].dependencies.scopes.size());
+  }
+  detail::reserve_node_ids(semantic_model_, program.id);
+  detail::AnalysisState state{semantic_model_, 0, {}};
+  AstVisitorFn visitor{detail::make_analysis_callbacks(state)};
+  AstVisitorFn reset_visitor{detail::make_reset_callbacks(semantic_model_)};
+  for (int i = 0; i <= num_procedures; i++) {
+    if (!is_reanalysed[i]) {
+      continue;
+    }
+    if (i < num_procedures) {
+      reset_visitor.visit(block.procedure_declarations[i]);
+    } else {
+      reset_visitor.visit(block.compound_statement);
+    }
+    state.current_scope = 0;
+    analyse_declaration(visitor, state, block, i, declarations_[i].dependencies.defines_header);
+  }
+  return result();
+}
+
+void IncrementalSemanticAnalyser::analyse_declaration(const AstVisitorFn& visitor,
+                                                      detail::AnalysisState& state,
+                                                      const Block& block,
+                                                      int index,
+                                                      bool replaces_header) {
+  Declaration& declaration = declarations_[index];
+  declaration.dependencies = detail::DeclarationDependencies{};
+  bool is_procedure = index < static_cast<int>(block.procedure_declarations.size());
+  const ProcedureDecl* procedure_decl = is_procedure ? &block.procedure_declarations[index] : nullptr;
+  detail::DeclarationTracking tracking{&semantic_model_.scopes.front(), &procedure_indices_, index,
+                                       procedure_decl, replaces_header, &declaration.dependencies};
+  state.tracking = &tracking;
+  if (procedure_decl != nullptr) {
+    declaration.name = procedure_decl->name;
+    declaration.parameter_types = detail::parameter_types_of(*procedure_decl);
+    visitor.visit(*procedure_decl);
+  } else {
+    visitor.visit(block.compound_statement);
+  }
+  state.tracking = nullptr;
+  declaration.errors = std::move(state.errors);
+  state.errors.clear();
+}
+
+const SemanticModel& IncrementalSemanticAnalyser::semantic_model() const {
+  return semantic_model_;
+}
+
+Result<const SemanticModel*, std::vector<SemanticAnalysisError>> IncrementalSemanticAnalyser::result() const {
+  std::vector<SemanticAnalysisError> errors = variable_declaration_errors_;
+  for (const auto& declaration : declarations_) {
+    errors.insert(errors.end(), declaration.errors.begin(), declaration.errors.end());
+  }
+  if (!errors.empty()) {
+    return make_error(std::move(errors));
+  }
+  return &semantic_model_;
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__INCREMENTAL_SEMANTIC_ANALYSER_H
+#define PASCAL_COMPILER_TUTORIAL__INCREMENTAL_SEMANTIC_ANALYSER_H
+
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "semantic_analyser.h"
+
+namespace freezing::interpreter {
+
+// Keeps the SemanticModel of a program that is being edited up to date, e.g. by the IncrementalParser. Top level
+// procedure declarations are analysed separately, so when some of them change, only they are re-analysed, together
+// with the declarations that look up their headers in the program scope. The result is the same as the one of a full
+// analysis, except that the tables indexed by NodeId keep the entries of the replaced nodes, and that the scopes of the
+// re-analysed declarations are numbered after the other ones.
+//
+// Programs that declare a top level procedure more than once and programs whose procedure bodies are parsed lazily are
+// always analysed fully.
+class IncrementalSemanticAnalyser {
+public:
+  IncrementalSemanticAnalyser() = default;
+  IncrementalSemanticAnalyser(const IncrementalSemanticAnalyser&) = delete;
+  IncrementalSemanticAnalyser& operator=(const IncrementalSemanticAnalyser&) = delete;
+
+  // Analyses the whole program. The model is valid until the next analysis, and for as long as the program exists.
+  Result<const SemanticModel*, std::vector<SemanticAnalysisError>> analyse(const Program& program);
+
+  // Re-analyses the program after the given top level procedure declarations were replaced in place. The rest of the
+  // program must be the same as in the last analysis.
+  Result<const SemanticModel*, std::vector<SemanticAnalysisError>> reanalyse(
+      const Program& program, const std::vector<const ProcedureDecl*>& changed_procedures);
+
+  // Model of the last analysis, also when it found errors. The names that don't resolve are left unresolved, as in a
+  // full analysis.
+  const SemanticModel& semantic_model() const;
+
+private:
+  // Top level procedure declaration, or the compound statement of the program, which is the last one.
+  struct Declaration {
+    // Header of the procedure, as seen by the callers. Empty for the compound statement.
+    Identifier name;
+    std::vector<TokenType> parameter_types;
+    detail::DeclarationDependencies dependencies;
+    std::vector<SemanticAnalysisError> errors;
+  };
+
+  SemanticModel semantic_model_;
+  Identifier program_name_;
+  std::vector<SemanticAnalysisError> variable_declaration_errors_;
+  std::vector<Declaration> declarations_;
+  // Index of each top level procedure, the first one if the name is declared more than once.
+  std::unordered_map<Identifier, int> procedure_indices_;
+  bool is_analysed_ = false;
+  // Scopes of the re-analysed declarations that were replaced. Once they outnumber the scopes in use, the program is
+  // analysed fully, which numbers the scopes densely again.
+  int num_unused_scopes_ = 0;
+
+  // Analyses the declaration with the given index in the program scope.
+  void analyse_declaration(const AstVisitorFn& visitor,
+                           detail::AnalysisState& state,
+                           const Block& block,
+                           int index,
+                           bool replaces_header);
+  Result<const SemanticModel*, std::vector<SemanticAnalysisError>> result() const;
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__INCREMENTAL_SEMANTIC_ANALYSER_H
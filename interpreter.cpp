@@ -3,152 +3,104 @@
 //
 
 #include "interpreter.h"
-#include "variant_match.h"
+#include "arithmetic.h"
 
 namespace freezing::interpreter {
 
-namespace detail {
+Interpreter::Interpreter(ExecutionMode execution_mode, ExecutionObserver* observer, ParsingMode parsing_mode)
+    : execution_mode_{execution_mode}, observer_{observer}, parsing_mode_{parsing_mode} {}
 
-DataType operator+(const DataType& lhs, const DataType& rhs) {
-  return std::visit([](auto&& lhs, auto&& rhs) -> DataType { return lhs + rhs; }, lhs, rhs);
-}
-
-DataType operator-(const DataType& lhs, const DataType& rhs) {
-  return std::visit([](auto&& lhs, auto&& rhs) -> DataType { return lhs - rhs; }, lhs, rhs);
-}
-
-// Unary -
-DataType operator-(const DataType& value) {
-  return std::visit([](auto&& value) -> DataType { return -value; }, value);
-}
-
-DataType operator*(const DataType& lhs, const DataType& rhs) {
-  return std::visit([](auto&& lhs, auto&& rhs) -> DataType { return lhs * rhs; }, lhs, rhs);
+InterpreterResult<ProgramState> Interpreter::run(std::string&& text) {
+  auto source_manager = std::make_unique<SourceManager>();
+  SourceId source_id = source_manager->add_buffer("<memory>", std::move(text));
+  auto result = run(*source_manager, source_id);
+  if (result) {
+    result->source_manager = std::move(source_manager);
+  }
+  return result;
 }
 
-Result<DataType, InterpreterError> operator/(const DataType& lhs, const DataType& rhs) {
-  return std::visit([](auto&& lhs, auto&& rhs) -> Result<DataType, InterpreterError> {
-    if (rhs != 0) {
-      return lhs / rhs;
+InterpreterResult<ProgramState> Interpreter::run(const SourceManager& source_manager, SourceId source_id) {
+  std::optional<Parser> parser;
+  if (parsing_mode_ == ParsingMode::STREAMING) {
+    parser = Parser::create_streaming(source_manager, source_id);
+  } else {
+    ParserOptions options{};
+    options.lazy_procedure_bodies = true;
+    auto lazy_parser = Parser::create(source_manager, source_id, options);
+    if (!lazy_parser) {
+      return forward_error(std::move(lazy_parser));
     }
-    return make_error(InterpreterError{"Invalid division by zero"});;
-  }, lhs, rhs);
-}
-
-static Result<DataType, InterpreterError> Calculate(DataType left, TokenType token_type, DataType right) {
-  switch (token_type) {
-  case TokenType::MINUS:
-    return left - right;
-  case TokenType::PLUS:
-    return left + right;
-  case TokenType::MUL:
-    return left * right;
-  case TokenType::INTEGER_DIV:
-  case TokenType::REAL_DIV:
-    return left / right;
-  case TokenType::OPEN_BRACKET:
-  case TokenType::CLOSED_BRACKET:
-  case TokenType::END_OF_FILE:
-  case TokenType::INTEGER:
-  case TokenType::DOT:
-  case TokenType::BEGIN:
-  case TokenType::END:
-  case TokenType::ASSIGN:
-  case TokenType::SEMICOLON:
-  case TokenType::ID:
-  case TokenType::INTEGER_CONST:
-  case TokenType::REAL_CONST:
-  case TokenType::COLON:
-  case TokenType::PROGRAM:
-  case TokenType::VAR:
-  case TokenType::REAL:
-  case TokenType::COMMA:
-  case TokenType::PROCEDURE:
-    break;
+    parser = std::move(*lazy_parser);
   }
-  assert(false);
-  return make_error(InterpreterError{"assertion"});
-}
-
-static DataType UnaryCalculate(DataType result, TokenType token_type) {
-  switch (token_type) {
-  case TokenType::MINUS:
-    return -result;
-  case TokenType::PLUS:
-    return result;
-  case TokenType::END_OF_FILE:
-  case TokenType::INTEGER:
-  case TokenType::MUL:
-  case TokenType::INTEGER_DIV:
-  case TokenType::OPEN_BRACKET:
-  case TokenType::CLOSED_BRACKET:
-  case TokenType::DOT:
-  case TokenType::BEGIN:
-  case TokenType::END:
-  case TokenType::ASSIGN:
-  case TokenType::SEMICOLON:
-  case TokenType::ID:
-  case TokenType::INTEGER_CONST:
-  case TokenType::REAL_CONST:
-  case TokenType::COLON:
-  case TokenType::PROGRAM:
-  case TokenType::VAR:
-  case TokenType::REAL:
-  case TokenType::REAL_DIV:
-  case TokenType::COMMA:
-  case TokenType::PROCEDURE:
-    break;
+  auto parsed_program = parser->parse_program();
+  if (!parsed_program) {
+    return make_error(variant_cast(parser->error(parsed_program.error())));
   }
-  assert(false);
-  return -1;
-}
-
-}
+  const Program& program = program_state_.program.emplace(std::move(*parsed_program));
 
-InterpreterResult<ProgramState> Interpreter::run(std::string&& text) {
-  auto parser = Parser::create(text);
-  if (!parser) {
-    return forward_error(std::move(parser));
+  auto semantic_model = SemanticAnalyser{}.analyse(program);
+  if (!semantic_model) {
+    program_state_.errors
+        .insert(program_state_.errors.end(), semantic_model.error().begin(), semantic_model.error().end());
+    return std::move(program_state_);
   }
-  auto program = parser->parse_program();
-  if (!program) {
-    return forward_error(std::move(program));
+  program_state_.semantic_model = std::move(*semantic_model);
+  ConstantFolder{}.fold(program, program_state_.semantic_model);
+
+  if (execution_mode_ == ExecutionMode::BYTECODE) {
+    // Compiler needs every block, so the lazily parsed ones are all prepared upfront.
+    auto prepared = prepare_nested_blocks(program.block);
+    if (!prepared) {
+      return make_error(errors_.get(prepared.error()));
+    }
+    auto bytecode = BytecodeCompiler{}.compile(program, program_state_.semantic_model);
+    auto result = VirtualMachine{observer_}.run(bytecode);
+    if (!result) {
+      return forward_error(std::move(result));
+    }
+    return std::move(program_state_);
   }
 
-  auto symbol_tables = SemanticAnalyser{}.analyse(text, *program);
-  if (!symbol_tables) {
-    program_state_.errors
-        .insert(program_state_.errors.end(), symbol_tables.error().begin(), symbol_tables.error().end());
-    return program_state_;
+  // The tree walker is instantiated separately for the unobserved case, so that it doesn't pay for the hooks.
+  auto result = observer_ != nullptr ? execute<true>(program) : execute<false>(program);
+  if (!result) {
+    return make_error(errors_.get(result.error()));
   }
-  program_state_.symbol_tables = std::move(*symbol_tables);
-  call_stack_.push(StackFrame{program->name, {}});
-  auto result = process(program->block.compound_statement);
+  assert(call_stack_.empty());
+  return std::move(program_state_);
+}
+
+template<bool kObserved>
+EvalResult<Void> Interpreter::execute(const Program& program) {
+  const auto& main_scope = program_state_.semantic_model.scopes.front();
+  push_call_stack<kObserved>(call_stack_.allocate(main_scope, -1));
+  auto result = process<kObserved>(program.block.compound_statement);
   if (!result) {
     return forward_error(std::move(result));
   }
-  pop_call_stack();
-  assert(call_stack_.empty());
-  return program_state_;
+  pop_call_stack<kObserved>();
+  return {};
 }
 
-InterpreterResult<Void> Interpreter::process(const CompoundStatement& compound_statement) {
+template<bool kObserved>
+EvalResult<Void> Interpreter::process(const CompoundStatement& compound_statement) {
   struct ProcessStatementFn {
     Interpreter& self;
 
-    InterpreterResult<Void> operator()(const ProcedureCall& procedure_call) {
-      return self.process(procedure_call);
+    EvalResult<Void> operator()(const ProcedureCall& procedure_call) {
+      return self.process<kObserved>(procedure_call);
     }
 
-    InterpreterResult<Void> operator()(const CompoundStatement& compound_statement) {
-      return self.process(compound_statement);
+    EvalResult<Void> operator()(const CompoundStatement& compound_statement) {
+      return self.process<kObserved>(compound_statement);
     }
 
-    InterpreterResult<Void> operator()(const AssignmentStatement& assignment_statement) {
-      return self.process(assignment_statement);
+    EvalResult<Void> operator()(const AssignmentStatement& assignment_statement) {
+      return self.process<kObserved>(assignment_statement);
     }
 
-    InterpreterResult<Void> operator()(const Empty& empty) {
+    EvalResult<Void> operator()(const Empty&) {
       return {};
     }
   };
@@ -162,112 +114,217 @@ InterpreterResult<Void> Interpreter::process(const CompoundStatement& compound_s
   return {};
 }
 
-InterpreterResult<Void> Interpreter::process(const ProcedureCall& procedure_call) {
-  StackFrame stack_frame{procedure_call.name, {}};
+EvalResult<const Block*> Interpreter::prepare_block(const LazyBlock& lazy_block) {
+  const Block* block = lazy_block.parsed();
+  if (block != nullptr && program_state_.semantic_model.unanalysed_blocks.count(&lazy_block) == 0) {
+    return block;
+  }
+  auto parsed = lazy_block.get();
+  if (!parsed) {
+    return errors_.add(ParserError{std::move(parsed.error())});
+  }
+  ScopeId scope = program_state_.semantic_model.unanalysed_blocks.at(&lazy_block).scope;
+  auto analysed = SemanticAnalyser{}.analyse_block(program_state_.semantic_model, lazy_block);
+  if (!analysed) {
+    // Only the first error is reported, since the program can't continue past it anyway.
+    return errors_.add(std::move(analysed.error().front()));
+  }
+  ConstantFolder{}.fold_block(**parsed, scope, program_state_.semantic_model);
+  return *parsed;
+}
+
+EvalResult<Void> Interpreter::prepare_nested_blocks(const Block& block) {
+  for (const auto& procedure_decl : block.procedure_declarations) {
+    auto nested_block = prepare_block(*procedure_decl.block);
+    if (!nested_block) {
+      return forward_error(std::move(nested_block));
+    }
+    auto result = prepare_nested_blocks(**nested_block);
+    if (!result) {
+      return forward_error(std::move(result));
+    }
+  }
+  return {};
+}
+
+template<bool kObserved>
+EvalResult<Void> Interpreter::process(const ProcedureCall& procedure_call) {
   // call_stack_ is guaranteed to have at least one element (main).
   assert(!call_stack_.empty() && "Call stack is guaranteed to have at least one element (main scope).");
-  const auto symbol_table = program_state_.symbol_tables[call_stack_.top().scope_name];
-  auto procedure_symbol = symbol_table.find_procedure_header(procedure_call.name);
-  assert(procedure_symbol.has_value() && "SemanticAnalyser guarantees that the procedure exists in the current scope.");
+  const auto* procedure_symbol = program_state_.semantic_model.call_targets[procedure_call.id];
+  assert(procedure_symbol != nullptr && "SemanticAnalyser resolves every procedure call.");
+  // Variables of the procedure are only known once its block is analysed, so it's prepared before the frame is
+  // allocated. Analysis grows the tables of the semantic model, so they're read only after it.
+  auto block = prepare_block(*procedure_symbol->block);
+  if (!block) {
+    return forward_error(std::move(block));
+  }
+  const auto& address = program_state_.semantic_model.addresses[procedure_call.id];
 
+  int static_link = call_stack_.frame_index_at(address.depth);
+  StackFrame stack_frame = call_stack_.allocate(*procedure_symbol->scope, static_link);
   assert(procedure_symbol->parameters.size() == procedure_call.parameters.size()
              && "SemanticAnalyser guarantees that the number of passed arguments is equal to the number of formal parameters.");
-  for (int param_idx = 0; param_idx < procedure_symbol->parameters.size(); param_idx++) {
-    const auto& formal_param = procedure_symbol->parameters[param_idx];
-    auto expr_result = eval(procedure_call.parameters[param_idx]);
+  for (size_t param_idx = 0; param_idx < procedure_symbol->parameters.size(); param_idx++) {
+    int slot = procedure_symbol->parameter_slots[param_idx];
+    if (slot == -1) {
+      continue;
+    }
+    auto param_type = value_type_of(procedure_symbol->parameters[param_idx].type_specification);
+    auto expr_result = eval(procedure_call.parameters[param_idx], param_type);
     if (!expr_result) {
+      call_stack_.release(stack_frame);
       return forward_error(std::move(expr_result));
     }
-    stack_frame.variables[formal_param.identifier] = *expr_result;
+    stack_frame.slots[slot] = *expr_result;
   }
-  call_stack_.push(std::move(stack_frame));
-  auto result = process(procedure_symbol->block->compound_statement);
-  pop_call_stack();
+  push_call_stack<kObserved>(stack_frame);
+  auto result = process<kObserved>((*block)->compound_statement);
+  pop_call_stack<kObserved>();
   return result;
 }
 
-InterpreterResult<Void> Interpreter::process(const AssignmentStatement& assignment_statement) {
-  auto result = eval(assignment_statement.expression);
+template<bool kObserved>
+EvalResult<Void> Interpreter::process(const AssignmentStatement& assignment_statement) {
+  const auto& variable = assignment_statement.variable;
+  auto result = eval(assignment_statement.expression, program_state_.semantic_model.expression_types[variable.id]);
   if (!result) {
     return forward_error(std::move(result));
   }
-  call_stack_.top().variables[assignment_statement.variable.name] = *result;
+  const auto& address = program_state_.semantic_model.addresses[variable.id];
+  auto& frame = frame_at(address.depth);
+  frame.slots[address.slot] = *result;
+  if constexpr (kObserved) {
+    observer_->on_assign(frame, address.slot, *result);
+  }
   return {};
   // TODO: free store memory is not supported yet.
 //  std::string address = address_of(call_stack_.top().scope_name, assignment_statement.variable.name);
 //  program_state_.memory.set(address, *result);
 }
 
-InterpreterResult<DataType> Interpreter::eval(const ExpressionNode& expression_node) {
-  struct ExpressionNodeEvalFn {
-    Interpreter& self;
-
-    InterpreterResult<DataType> operator()(const BinOp& bin_op) {
-      auto left = self.eval(*bin_op.left);
-      if (!left) {
-        return forward_error(std::move(left));
-      }
-      auto right = self.eval(*bin_op.right);
-      if (!right) {
-        return forward_error(std::move(right));
+// Evaluates nodes as T, which is int or double. Nodes of type INTEGER that are evaluated as double
+// are evaluated as int first and then promoted, so that e.g. DIV keeps integer semantics.
+template<typename T>
+struct Interpreter::ExpressionNodeEvalFn {
+  Interpreter& self;
+
+  template<typename NodeT>
+  EvalResult<T> operator()(const NodeT& node) {
+    if constexpr (std::is_same_v<T, double>) {
+      if (self.program_state_.semantic_model.expression_types[node.id] == ValueType::INTEGER) {
+        auto value = ExpressionNodeEvalFn<int>{self}(node);
+        if (!value) {
+          return forward_error(std::move(value));
+        }
+        return static_cast<double>(*value);
       }
-      return detail::Calculate(*left, bin_op.op_type, *right);
     }
+    return eval(node);
+  }
 
-    InterpreterResult<DataType> operator()(const UnaryOp& unary_op) {
-      auto result = self.eval(*unary_op.node);
-      if (!result) {
-        return forward_error(std::move(result));
-      }
-      return detail::UnaryCalculate(*result, unary_op.op_type);
+  // Operations that were folded at compile time aren't evaluated again. Variables with constant values are read from
+  // their slots anyway, which is just as fast.
+  EvalResult<T> eval(const BinOp& bin_op) {
+    if (const auto& constant_value = self.program_state_.semantic_model.constant_values[bin_op.id]) {
+      return as_value(*constant_value);
     }
+    auto left = self.eval<T>(*bin_op.left);
+    if (!left) {
+      return forward_error(std::move(left));
+    }
+    auto right = self.eval<T>(*bin_op.right);
+    if (!right) {
+      return forward_error(std::move(right));
+    }
+    auto result = detail::Calculate(*left, bin_op.op_type, *right);
+    if (!result) {
+      return self.errors_.add(detail::division_by_zero_error());
+    }
+    return *result;
+  }
 
-    InterpreterResult<DataType> operator()(const Variable& variable) {
-      auto value = self.read_variable_value(variable.name);
-      if (!value) {
-        // SemanticAnalyser is responsible for ensuring that the variable is declared.
-        // However, it doesn't ensure that it is initialized.
-        // Therefore, at this point if the variable doesn't exist in memory, then it is uninitialized.
-        return make_error(InterpreterError{
-            fmt::format("Cannot read uninitialized variable '{}' in scope '{}'",
-                        variable.name,
-                        self.call_stack_.top().scope_name)});
-      }
-      return *value;
+  EvalResult<T> eval(const UnaryOp& unary_op) {
+    if (const auto& constant_value = self.program_state_.semantic_model.constant_values[unary_op.id]) {
+      return as_value(*constant_value);
     }
+    auto result = self.eval<T>(*unary_op.node);
+    if (!result) {
+      return forward_error(std::move(result));
+    }
+    return detail::UnaryCalculate(*result, unary_op.op_type);
+  }
 
-    InterpreterResult<DataType> operator()(const Num& num) {
-      return num.value;
+  EvalResult<T> eval(const Variable& variable) {
+    auto value = self.read_variable_value(self.program_state_.semantic_model.addresses[variable.id]);
+    if (!value) {
+      // SemanticAnalyser is responsible for ensuring that the variable is declared.
+      // However, it doesn't ensure that it is initialized.
+      // Therefore, at this point if the variable doesn't exist in memory, then it is uninitialized.
+      return self.errors_.add(InterpreterError{
+          fmt::format("Cannot read uninitialized variable '{}' in scope '{}'",
+                      variable.name,
+                      self.call_stack_.top().scope->name())});
     }
-  };
+    return as_value(*value);
+  }
+
+  EvalResult<T> eval(const Num& num) {
+    return std::get<T>(num.value);
+  }
+
+  static T as_value(const DataType& value) {
+    if constexpr (std::is_same_v<T, int>) {
+      return detail::as_integer(value);
+    } else {
+      return detail::as_real(value);
+    }
+  }
+};
 
-  return std::visit(ExpressionNodeEvalFn{*this}, expression_node);
+template<typename T>
+EvalResult<T> Interpreter::eval(const ExpressionNode& expression_node) {
+  return std::visit(ExpressionNodeEvalFn<T>{*this}, expression_node);
+}
+
+EvalResult<DataType> Interpreter::eval(const ExpressionNode& expression_node, ValueType type) {
+  if (type == ValueType::INTEGER) {
+    return eval<int>(expression_node);
+  }
+  return eval<double>(expression_node);
 }
 
 std::string Interpreter::address_of(const std::string& scope_name, const std::string& variable_name) {
   return fmt::format("{}_{}", scope_name, variable_name);
 }
 
-std::optional<DataType> Interpreter::read_variable_value(const std::string& variable_name) const {
-  // TODO: Read recursively from all stack frames, rather than just from the current.
-  const auto& stack_variables = call_stack_.top().variables;
-  auto it = stack_variables.find(variable_name);
-  if (it != stack_variables.end()) {
-    return it->second;
-  }
+StackFrame& Interpreter::frame_at(int depth) {
+  return call_stack_[call_stack_.frame_index_at(depth)];
+}
+
+std::optional<DataType> Interpreter::read_variable_value(const LexicalAddress& address) {
+  return frame_at(address.depth).slots[address.slot];
 
   // If the variable can't be found in the stack, search for it in the memory.
   // TODO: Current interpreter doesn't support free store memory as a concept.
 //  const auto& scope_name = call_stack_.top().scope_name;
 //  std::string address = address_of(scope_name, variable_name);
 //  return program_state_.memory.try_read(address);
-  return {};
 }
+
+template<bool kObserved>
+void Interpreter::push_call_stack(const StackFrame& stack_frame) {
+  call_stack_.push(stack_frame);
+  if constexpr (kObserved) {
+    observer_->on_call(call_stack_.top());
+  }
+}
+
+template<bool kObserved>
 void Interpreter::pop_call_stack() {
-  // TODO: Print only if stack debugging is enabled.
-  // Even better, invoke a callback that can be passed to interpreter.
-  StackFrame stack_frame = call_stack_.top();
-  std::cout << stack_frame << std::endl;
+  if constexpr (kObserved) {
+    observer_->on_return(call_stack_.top());
+  }
   call_stack_.pop();
 }
 
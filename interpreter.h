@@ -5,11 +5,12 @@
 #ifndef PASCAL_COMPILER_TUTORIAL__INTERPRETER_H
 #define PASCAL_COMPILER_TUTORIAL__INTERPRETER_H
 
-#include <stack>
 #include <string>
 #include <map>
+#include <memory>
+#include <optional>
 #include <variant>
-#include "stack_frame.h"
+#include "call_stack.h"
 #include "ast_visitor.h"
 #include "result.h"
 #include "parser.h"
@@ -17,43 +18,89 @@
 #include "memory.h"
 #include "symbol_table.h"
 #include "semantic_analyser.h"
+#include "constant_folder.h"
+#include "interpreter_error.h"
+#include "bytecode_compiler.h"
+#include "virtual_machine.h"
+#include "execution_observer.h"
+#include "source_manager.h"
 
 namespace freezing::interpreter {
 
-struct InterpreterError {
-  std::string message;
-
-  friend std::ostream& operator<<(std::ostream& os, const InterpreterError& e) {
-    return os << "InterpreterError: " << e.message;
-  }
+// Tree walking is kept as the reference implementation; the bytecode mode is expected to behave identically.
+enum class ExecutionMode {
+  TREE_WALKER,
+  BYTECODE,
 };
 
-using InterpreterErrorsT = std::variant<InterpreterError, SemanticAnalysisError, ParserError, LexerError>;
-
-template<typename T>
-using InterpreterResult = Result<T, InterpreterErrorsT>;
+enum class ParsingMode {
+  // Whole program is parsed upfront by the streaming parser.
+  STREAMING,
+  // Procedure bodies are parsed and analysed when the procedure is first called.
+  LAZY_PROCEDURE_BODIES,
+};
 
 struct ProgramState {
+  // Source of the program if it was run from memory, null otherwise. Declared before the program, whose unparsed
+  // blocks view the text, so that it's destroyed after it.
+  std::unique_ptr<SourceManager> source_manager;
+  // Owns the nodes that the symbols and the tables of the model point to, e.g. the blocks of the procedure headers,
+  // so it's kept for as long as the model. Empty if the program couldn't be parsed. Blocks that were never needed stay
+  // unparsed, and can be parsed only while the source is alive.
+  std::optional<Program> program;
   Memory memory;
-  // TODO: Rename to scopes.
-  std::map<std::string, SymbolTable> symbol_tables;
+  SemanticModel semantic_model;
   std::vector<InterpreterErrorsT> errors;
 };
 
 class Interpreter {
 public:
+  // The observer is optional and must outlive the interpreter.
+  explicit Interpreter(ExecutionMode execution_mode = ExecutionMode::BYTECODE,
+                       ExecutionObserver* observer = nullptr,
+                       ParsingMode parsing_mode = ParsingMode::STREAMING);
+
+  InterpreterResult<ProgramState> run(const SourceManager& source_manager, SourceId source_id);
+  // Runs the program that is only in memory. The returned state owns the source, but the errors don't, so their
+  // diagnostics can't be rendered.
   InterpreterResult<ProgramState> run(std::string&& text);
 
 private:
+  ExecutionMode execution_mode_;
+  ExecutionObserver* observer_;
+  ParsingMode parsing_mode_;
   ProgramState program_state_;
-  std::stack<StackFrame> call_stack_;
-
-  InterpreterResult<Void> process(const ProcedureCall& procedure_call);
-  InterpreterResult<Void> process(const CompoundStatement& compound_statement);
-  InterpreterResult<Void> process(const AssignmentStatement& assignment_statement);
-  InterpreterResult<DataType> eval(const ExpressionNode& expression_node);
-
-  std::optional<DataType> read_variable_value(const std::string& value) const;
+  CallStack call_stack_;
+  ErrorStore<InterpreterErrorsT> errors_;
+
+  // Parses and analyses the block of the procedure, unless that's already done.
+  EvalResult<const Block*> prepare_block(const LazyBlock& lazy_block);
+  // Prepares the blocks of all the procedures declared in the block, in source order.
+  EvalResult<Void> prepare_nested_blocks(const Block& block);
+  // Statements are processed without the observer hooks unless kObserved is set.
+  template<bool kObserved>
+  EvalResult<Void> execute(const Program& program);
+  template<bool kObserved>
+  EvalResult<Void> process(const ProcedureCall& procedure_call);
+  template<bool kObserved>
+  EvalResult<Void> process(const CompoundStatement& compound_statement);
+  template<bool kObserved>
+  EvalResult<Void> process(const AssignmentStatement& assignment_statement);
+  // Evaluates the expression into a value of the given type. The type is either the same as the static type of
+  // the expression or REAL, in which case INTEGER is promoted.
+  EvalResult<DataType> eval(const ExpressionNode& expression_node, ValueType type);
+  template<typename T>
+  EvalResult<T> eval(const ExpressionNode& expression_node);
+
+  template<typename T>
+  struct ExpressionNodeEvalFn;
+
+  // Returns the frame that is depth static links away from the current one.
+  StackFrame& frame_at(int depth);
+  std::optional<DataType> read_variable_value(const LexicalAddress& address);
+  template<bool kObserved>
+  void push_call_stack(const StackFrame& stack_frame);
+  template<bool kObserved>
   void pop_call_stack();
 
   static std::string address_of(const std::string& scope_name, const std::string& variable_name);
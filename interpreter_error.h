@@ -0,0 +1,33 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__INTERPRETER_ERROR_H
+#define PASCAL_COMPILER_TUTORIAL__INTERPRETER_ERROR_H
+
+#include <iostream>
+#include <string>
+#include <variant>
+#include "result.h"
+#include "parser.h"
+#include "semantic_analyser.h"
+#include "error_store.h"
+
+namespace freezing::interpreter {
+
+struct InterpreterError {
+  std::string message;
+
+  friend std::ostream& operator<<(std::ostream& os, const InterpreterError& e) {
+    return os << "InterpreterError: " << e.message;
+  }
+};
+
+using InterpreterErrorsT = std::variant<InterpreterError, SemanticAnalysisError, ParserError, LexerError>;
+
+template<typename T>
+using InterpreterResult = Result<T, InterpreterErrorsT>;
+
+// Used by the tree walker, whose errors are kept in the interpreter's error store.
+template<typename T>
+using EvalResult = Result<T, ErrorId>;
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__INTERPRETER_ERROR_H
@@ -0,0 +1,33 @@
+#include "lazy_block.h"
+#include "parser.h"
+
+namespace freezing::interpreter {
+
+LazyBlock::LazyBlock(const Block* block) : parser_{nullptr}, begin_{0}, end_{0}, block_{block} {}
+
+LazyBlock::LazyBlock(DeferredParser* parser, int begin, int end)
+    : parser_{parser}, begin_{begin}, end_{end}, block_{nullptr} {}
+
+Result<const Block*, Diagnostic> LazyBlock::get() const {
+  if (const Block* block = parsed()) {
+    return block;
+  }
+  std::call_once(parse_once_, [this]() {
+    auto block = parser_->parse_block(begin_, end_);
+    if (!block) {
+      error_ = std::move(block).error();
+      return;
+    }
+    block_.store(*block, std::memory_order_release);
+  });
+  if (error_) {
+    return make_error(*error_);
+  }
+  return parsed();
+}
+
+const Block* LazyBlock::parsed() const {
+  return block_.load(std::memory_order_acquire);
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__LAZY_BLOCK_H
+#define PASCAL_COMPILER_TUTORIAL__LAZY_BLOCK_H
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include "diagnostics.h"
+#include "result.h"
+
+namespace freezing::interpreter {
+
+struct Block;
+class DeferredParser;
+
+// Block of a procedure declaration. When procedure bodies are parsed lazily, the parser only checks that the body is
+// balanced and records where it is, and the block itself is parsed the first time it's needed.
+class LazyBlock {
+public:
+  // Block that was parsed upfront.
+  explicit LazyBlock(const Block* block);
+  // Block that spans tokens [begin, end), which is parsed by the parser when it's first needed.
+  LazyBlock(DeferredParser* parser, int begin, int end);
+  LazyBlock(const LazyBlock&) = delete;
+  LazyBlock& operator=(const LazyBlock&) = delete;
+
+  // Parses the block, unless it's already parsed. It's safe to call concurrently, the block is parsed only once and
+  // every caller gets the same result.
+  Result<const Block*, Diagnostic> get() const;
+  // Returns the block, or nullptr if it hasn't been parsed yet.
+  const Block* parsed() const;
+
+private:
+  DeferredParser* parser_;
+  int begin_;
+  int end_;
+  mutable std::once_flag parse_once_;
+  mutable std::atomic<const Block*> block_;
+  // Written only under parse_once_, so it's safe to read once get() has passed it.
+  mutable std::optional<Diagnostic> error_;
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__LAZY_BLOCK_H
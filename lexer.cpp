@@ -2,16 +2,27 @@
 // Created by nikola on 3/2/2021.
 //
 
-#include <iomanip>
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <limits>
+#include <optional>
 #include <utility>
 #include "lexer.h"
-#include "debug.h"
+#include "identifier.h"
+#include "char_scanner.h"
 
 namespace freezing::interpreter {
 
-// TODO: Should be token types.
-const std::map<std::string, TokenType>
-    kReservedKeywords{
+namespace detail {
+
+struct Keyword {
+  // Always upper case.
+  std::string_view spelling;
+  TokenType token_type;
+};
+
+constexpr Keyword kReservedKeywords[] = {
     {"PROGRAM", TokenType::PROGRAM},
     {"VAR", TokenType::VAR},
     {"DIV", TokenType::INTEGER_DIV},
@@ -22,9 +33,75 @@ const std::map<std::string, TokenType>
     {"PROCEDURE", TokenType::PROCEDURE},
 };
 
-Lexer::Lexer(std::string&& text) : text_{std::move(text)}, pos_{0}, current_location_{0, 0} {}
+constexpr char to_upper(char c) {
+  return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// Keywords are recognized by a perfect hash of the length, the first and the last character, so every identifier is
+// compared against at most one keyword. Size of the table is a power of two.
+constexpr int kKeywordTableSize = 16;
+
+constexpr int keyword_hash(std::string_view word) {
+  return (static_cast<int>(word.size()) + to_upper(word.front()) + 3 * to_upper(word.back())) & (kKeywordTableSize - 1);
+}
+
+// Maps the hash to the index in kReservedKeywords, or -1 if no keyword has that hash.
+constexpr std::array<int8_t, kKeywordTableSize> make_keyword_table() {
+  std::array<int8_t, kKeywordTableSize> table{};
+  for (auto& entry : table) {
+    entry = -1;
+  }
+  for (int i = 0; i < static_cast<int>(std::size(kReservedKeywords)); i++) {
+    table[keyword_hash(kReservedKeywords[i].spelling)] = static_cast<int8_t>(i);
+  }
+  return table;
+}
+
+constexpr std::array<int8_t, kKeywordTableSize> kKeywordTable = make_keyword_table();
+
+constexpr bool is_keyword_hash_perfect() {
+  for (int i = 0; i < static_cast<int>(std::size(kReservedKeywords)); i++) {
+    if (kKeywordTable[keyword_hash(kReservedKeywords[i].spelling)] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(is_keyword_hash_perfect(),
+              "Keywords collide, change keyword_hash() or increase the kKeywordTableSize when adding a keyword.");
 
-Lexer::Lexer(const std::string& text) : text_{text}, pos_{0}, current_location_{0, 0} {}
+// Pascal keywords are case insensitive.
+constexpr std::optional<TokenType> find_keyword(std::string_view word) {
+  int index = kKeywordTable[keyword_hash(word)];
+  if (index < 0) {
+    return std::nullopt;
+  }
+  const Keyword& keyword = kReservedKeywords[index];
+  if (keyword.spelling.size() != word.size()) {
+    return std::nullopt;
+  }
+  for (int i = 0; i < static_cast<int>(word.size()); i++) {
+    if (to_upper(word[i]) != keyword.spelling[i]) {
+      return std::nullopt;
+    }
+  }
+  return keyword.token_type;
+}
+
+static_assert(find_keyword("Begin") == TokenType::BEGIN);
+static_assert(!find_keyword("BEGINS").has_value());
+
+}
+
+Lexer::Lexer(std::string_view text, SourceId source_id) : Lexer{text, source_id, 0} {}
+
+Lexer::Lexer(std::string_view text, SourceId source_id, int pos) : Lexer{text, source_id, pos, CharLocation{0, 0}} {
+  assert(pos == 0 || text_[pos - 1] == '\n');
+}
+
+Lexer::Lexer(std::string_view text, SourceId source_id, int pos, CharLocation location)
+    : text_{text}, source_id_{source_id}, pos_{pos}, current_location_{location} {}
 
 const Token& Lexer::peek() {
   return current_token_;
@@ -39,8 +116,27 @@ LexerResult<Void> Lexer::advance() {
   return {};
 }
 
+LexerResult<std::vector<Token>> Lexer::lex_all() {
+  std::vector<Token> tokens;
+  while (true) {
+    auto advance_check = advance();
+    if (!advance_check) {
+      return forward_error(std::move(advance_check));
+    }
+    tokens.push_back(current_token_);
+    if (current_token_.token_type == TokenType::END_OF_FILE) {
+      return tokens;
+    }
+  }
+}
+
+CharLocation Lexer::location() const {
+  return current_location_;
+}
+
 char Lexer::peek_char() const {
-  return text_[pos_];
+  // Unlike std::string, the view isn't null terminated.
+  return pos_ < static_cast<int>(text_.size()) ? text_[pos_] : '\0';
 }
 
 char Lexer::next_char() {
@@ -52,92 +148,133 @@ char Lexer::next_char() {
   return text_[pos_++];
 }
 
-void Lexer::skip_whitespaces() {
-  while (pos_ < text_.size() && isspace(text_[pos_])) {
-    next_char();
+void Lexer::advance_to(int pos) {
+  int num_new_lines = count_char(text_, pos_, pos, '\n');
+  if (num_new_lines == 0) {
+    current_location_.column_number += pos - pos_;
+  } else {
+    current_location_.line_number += num_new_lines;
+    current_location_.column_number = pos - static_cast<int>(text_.rfind('\n', pos - 1)) - 1;
   }
+  pos_ = pos;
+}
+
+void Lexer::skip_whitespaces() {
+  advance_to(skip_spaces(text_, pos_));
 }
 
 void Lexer::skip_until_comment_close() {
-  while (pos_ < text_.size()) {
-    if (next_char() == '}') {
-      break;
-    }
-  }
+  int comment_close = find_char(text_, pos_, '}');
+  advance_to(comment_close < static_cast<int>(text_.size()) ? comment_close + 1 : comment_close);
 }
 
 LexerResult<Token> Lexer::parse_token() {
   while (true) {
     skip_whitespaces();
-    if (pos_ >= text_.size()) {
-      return {Token{current_location_, TokenType::END_OF_FILE, {}}};
+    if (pos_ >= static_cast<int>(text_.size())) {
+      return make_token(TokenType::END_OF_FILE, current_location_, pos_);
     }
 
     // TODO: Use peek_char().
+    int offset = pos_;
     char current_char = next_char();
     CharLocation location = current_location_;
 
     if (current_char == '{') {
       skip_until_comment_close();
       continue;
-    } else if (isdigit(current_char)) {
-      std::string value;
-      value += current_char;
-
-      while (pos_ < text_.size() && isdigit(peek_char())) {
-        value += next_char();
-      }
-
-      if (peek_char() != '.') {
-        return Token{location, TokenType::INTEGER_CONST, std::move(value)};
-      }
-      // Otherwise it's REAL.
-      value += next_char();
-      while (pos_ < text_.size() && isdigit(peek_char())) {
-        value += next_char();
-      }
-      return Token{location, TokenType::REAL_CONST, std::move(value)};
+    } else if (is_digit_char(current_char)) {
+      return parse_number(location, offset);
     } else if (current_char == '+') {
-      return Token{location, TokenType::PLUS, "+"};
+      return make_token(TokenType::PLUS, location, offset);
     } else if (current_char == '-') {
-      return Token{location, TokenType::MINUS, "-"};
+      return make_token(TokenType::MINUS, location, offset);
     } else if (current_char == '*') {
-      return Token{location, TokenType::MUL, "*"};
+      return make_token(TokenType::MUL, location, offset);
     } else if (current_char == '/') {
-      return Token{location, TokenType::REAL_DIV, "/"};
+      return make_token(TokenType::REAL_DIV, location, offset);
     } else if (current_char == '(') {
-      return Token{location, TokenType::OPEN_BRACKET, "("};
+      return make_token(TokenType::OPEN_BRACKET, location, offset);
     } else if (current_char == ')') {
-      return Token{location, TokenType::CLOSED_BRACKET, ")"};
+      return make_token(TokenType::CLOSED_BRACKET, location, offset);
     } else if (current_char == '.') {
-      return Token{location, TokenType::DOT, "."};
+      return make_token(TokenType::DOT, location, offset);
     } else if (current_char == ':' && peek_char() == '=') {
       next_char();
-      return Token{location, TokenType::ASSIGN, ":="};
+      return make_token(TokenType::ASSIGN, location, offset);
     } else if (current_char == ':') {
-      return Token{location, TokenType::COLON, ":"};
+      return make_token(TokenType::COLON, location, offset);
     } else if (current_char == ';') {
-      return Token{location, TokenType::SEMICOLON, ";"};
+      return make_token(TokenType::SEMICOLON, location, offset);
     } else if (current_char == ',') {
-      return Token{location, TokenType::COMMA, ","};
-    } else if (isalpha(current_char)) {
-      std::string id;
-      id += current_char;
+      return make_token(TokenType::COMMA, location, offset);
+    } else if (is_alpha_char(current_char)) {
+      advance_to(skip_alnums(text_, pos_));
 
-      while (pos_ < text_.size() && isalnum(peek_char())) {
-        id += next_char();
+      std::string_view word = text_.substr(offset, pos_ - offset);
+      auto keyword = detail::find_keyword(word);
+      if (!keyword) {
+        Token token = make_token(TokenType::ID, location, offset);
+        token.value.identifier = Identifier{word}.id();
+        return token;
       }
+      return make_token(*keyword, location, offset);
+    }
+    return lexer_error(DiagnosticCode::UNKNOWN_CHARACTER, offset, {std::string(1, current_char)});
+  }
+}
 
-      auto it = kReservedKeywords.find(id);
-      if (it == kReservedKeywords.end()) {
-        return Token{location, TokenType::ID, std::move(id)};
-      }
-      return Token{location, it->second, fmt::format("{}", it->second)};
+LexerResult<Token> Lexer::parse_number(CharLocation location, int offset) {
+  advance_to(skip_digits(text_, pos_));
+  bool is_real = false;
+  if (peek_char() == '.') {
+    next_char();
+    advance_to(skip_digits(text_, pos_));
+    is_real = true;
+  }
+  if (peek_char() == 'e' || peek_char() == 'E') {
+    int exponent_offset = pos_;
+    next_char();
+    if (peek_char() == '+' || peek_char() == '-') {
+      next_char();
+    }
+    if (!is_digit_char(peek_char())) {
+      return lexer_error(DiagnosticCode::MISSING_EXPONENT_DIGITS, exponent_offset,
+                         {std::string{text_.substr(offset, exponent_offset - offset)}});
+    }
+    advance_to(skip_digits(text_, pos_));
+    is_real = true;
+  }
+
+  Token token = make_token(is_real ? TokenType::REAL_CONST : TokenType::INTEGER_CONST, location, offset);
+  const char* begin = text_.data() + offset;
+  const char* end = text_.data() + pos_;
+  // Unlike std::stoi and std::stod, from_chars doesn't depend on the locale and doesn't throw.
+  std::from_chars_result result;
+  if (is_real) {
+    result = std::from_chars(begin, end, token.value.real);
+  } else {
+    result = std::from_chars(begin, end, token.value.integer);
+    if (result.ec == std::errc{} && token.value.integer > std::numeric_limits<int>::max()) {
+      result.ec = std::errc::result_out_of_range;
     }
-    return make_error(LexerError{location, fmt::format("Unknown character sequence: {}\n{}",
-                                                       current_char,
-                                                       debug_output(text_, current_location_))});
   }
+  // The characters were already checked, so only the range can be wrong.
+  assert(result.ptr == end || result.ec != std::errc{});
+  if (result.ec != std::errc{}) {
+    return lexer_error(DiagnosticCode::CONSTANT_OUT_OF_RANGE, offset,
+                       {is_real ? "REAL" : "INTEGER", std::string{text_.substr(offset, pos_ - offset)}});
+  }
+  return token;
+}
+
+Error<LexerError> Lexer::lexer_error(DiagnosticCode code, int offset, std::vector<std::string> arguments) const {
+  return make_error(LexerError{Diagnostic{code, source_id_, static_cast<uint32_t>(offset), std::move(arguments)}});
+}
+
+Token Lexer::make_token(TokenType token_type, CharLocation location, int offset) const {
+  return Token{token_type, PackedCharLocation{location}, static_cast<uint32_t>(offset),
+               static_cast<uint32_t>(pos_ - offset), TokenValue{}};
 }
 
-}
\ No newline at end of file
+}
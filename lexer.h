@@ -7,21 +7,19 @@
 
 #include <cassert>
 #include <fmt/format.h>
-#include <map>
+#include <string_view>
+#include <vector>
 #include "result.h"
 #include "token.h"
+#include "diagnostics.h"
 
 namespace freezing::interpreter {
 
 struct LexerError {
-  CharLocation location;
-  std::string message;
+  Diagnostic diagnostic;
 
   friend std::ostream& operator<<(std::ostream& os, const LexerError& e) {
-    return os << fmt::format("LexerError(line and column = ({}, {})): {}",
-                             e.location.line_number,
-                             e.location.column_number,
-                             e.message);
+    return os << "LexerError: " << e.diagnostic;
   }
 };
 
@@ -30,17 +28,28 @@ using LexerResult = Result<T, LexerError>;
 
 class Lexer {
 public:
-  explicit Lexer(std::string&& text);
-  explicit Lexer(const std::string& text);
+  // The text isn't copied, so it must outlive the lexer and the tokens.
+  Lexer(std::string_view text, SourceId source_id);
+  // Lexes text[pos, text.size()). The position must be at the start of a line, which becomes line 0.
+  Lexer(std::string_view text, SourceId source_id, int pos);
+  // Lexes text[pos, text.size()), where the position is outside of any comment and the location is of the character
+  // at the position. The lexer looks at most one character past the end of a token, so the position can be right
+  // after any token.
+  Lexer(std::string_view text, SourceId source_id, int pos, CharLocation location);
 
   // Returns the token after the last successful advance() call.
   // The result is undefined if the advance() method hasn't been called.
   const Token& peek();
   LexerResult<Void> advance();
+  // Lexes the rest of the text. The last token is END_OF_FILE.
+  LexerResult<std::vector<Token>> lex_all();
+  // Location of the next character.
+  CharLocation location() const;
 
 private:
   // Text to interpret.
-  std::string text_;
+  std::string_view text_;
+  SourceId source_id_;
   // Position of the next character in text.
   int pos_;
   Token current_token_;
@@ -48,9 +57,16 @@ private:
 
   char peek_char() const;
   char next_char();
+  // Moves to the given position, updating the location by counting the new lines in between.
+  void advance_to(int pos);
   void skip_whitespaces();
   void skip_until_comment_close();
   LexerResult<Token> parse_token();
+  // Scans the rest of a numeric constant that starts at the offset and decodes its value.
+  LexerResult<Token> parse_number(CharLocation location, int offset);
+  Error<LexerError> lexer_error(DiagnosticCode code, int offset, std::vector<std::string> arguments) const;
+  // Returns the token that spans from the offset to the current position.
+  Token make_token(TokenType token_type, CharLocation location, int offset) const;
 };
 
 }
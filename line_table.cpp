@@ -0,0 +1,39 @@
+#include <algorithm>
+#include <cassert>
+#include "line_table.h"
+#include "char_scanner.h"
+
+namespace freezing::interpreter {
+
+LineTable::LineTable(std::string_view text) {
+  line_starts_.reserve(count_char(text, 0, text.size(), '\n') + 1);
+  line_starts_.push_back(0);
+  int size = static_cast<int>(text.size());
+  // New line at the very end doesn't start another line.
+  for (int pos = find_char(text, 0, '\n'); pos + 1 < size; pos = find_char(text, pos + 1, '\n')) {
+    line_starts_.push_back(pos + 1);
+  }
+}
+
+CharLocation LineTable::location(uint32_t offset) const {
+  // The last line that starts at or before the offset.
+  auto it = std::upper_bound(line_starts_.begin(), line_starts_.end(), offset) - 1;
+  return CharLocation{static_cast<int>(it - line_starts_.begin()), static_cast<int>(offset - *it) + 1};
+}
+
+int LineTable::num_lines() const {
+  return line_starts_.size();
+}
+
+std::string_view LineTable::line(std::string_view text, int line_number) const {
+  assert(line_number < num_lines());
+  uint32_t begin = line_starts_[line_number];
+  uint32_t end = line_number + 1 < num_lines() ? line_starts_[line_number + 1] - 1 : text.size();
+  // New line at the very end of the text.
+  if (end > begin && text[end - 1] == '\n') {
+    end--;
+  }
+  return text.substr(begin, end - begin);
+}
+
+}
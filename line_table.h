@@ -0,0 +1,29 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__LINE_TABLE_H
+#define PASCAL_COMPILER_TUTORIAL__LINE_TABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "token.h"
+
+namespace freezing::interpreter {
+
+// Offsets at which the lines of a text start. It's built once per text, after which the location of any offset is
+// found by a binary search instead of walking the text.
+class LineTable {
+public:
+  explicit LineTable(std::string_view text);
+
+  // Same convention as the lexer: lines are counted from 0 and columns from 1.
+  CharLocation location(uint32_t offset) const;
+  int num_lines() const;
+  // Returns the line without the new line character.
+  std::string_view line(std::string_view text, int line_number) const;
+
+private:
+  std::vector<uint32_t> line_starts_;
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__LINE_TABLE_H
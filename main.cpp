@@ -3,20 +3,53 @@
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "source_manager.h"
 #include "variant_ostream.h"
 
 using namespace freezing::interpreter;
 
-int visualise_ast(std::string&& pascal_program) {
-  auto parser = Parser::create(std::move(pascal_program));
+struct DiagnosticOfFn {
+  const Diagnostic* operator()(const LexerError& error) const {
+    return &error.diagnostic;
+  }
+
+  const Diagnostic* operator()(const ParserError& error) const {
+    return &error.diagnostic;
+  }
+
+  template<typename T>
+  const Diagnostic* operator()(const T&) const {
+    return nullptr;
+  }
+};
+
+// Errors found in the source are reported to the engine and printed together with the lines around them.
+template<typename ErrorT>
+void print_error(DiagnosticsEngine& diagnostics, const ErrorT& error) {
+  const Diagnostic* diagnostic = DiagnosticOfFn{}(error);
+  if (diagnostic == nullptr) {
+    std::cout << error << std::endl;
+    return;
+  }
+  diagnostics.report(*diagnostic);
+  std::cout << diagnostics.render(diagnostics.diagnostics().back());
+}
+
+template<typename... Ts>
+void print_error(DiagnosticsEngine& diagnostics, const std::variant<Ts...>& error) {
+  std::visit([&diagnostics](const auto& e) { print_error(diagnostics, e); }, error);
+}
+
+int visualise_ast(const SourceManager& source_manager, SourceId source_id, DiagnosticsEngine& diagnostics) {
+  auto parser = Parser::create(source_manager, source_id);
   if (!parser) {
-    std::cout << parser.error() << std::endl;
+    print_error(diagnostics, parser.error());
     return -1;
   }
 
   auto ast = parser->parse_program();
   if (!ast) {
-    std::cout << ast.error() << std::endl;
+    print_error(diagnostics, parser->error(ast.error()));
     return -1;
   }
   std::string dot = AstDotVisualiser{}.generate(*ast);
@@ -24,10 +57,16 @@ int visualise_ast(std::string&& pascal_program) {
   return 0;
 }
 
-int run_interpreter(std::string&& pascal_program) {
-  auto result = Interpreter{}.run(std::move(pascal_program));
+int run_interpreter(const SourceManager& source_manager,
+                    SourceId source_id,
+                    DiagnosticsEngine& diagnostics,
+                    bool trace) {
+  StackFrameDumpObserver stack_frame_dump{};
+  auto result = Interpreter{ExecutionMode::BYTECODE, trace ? &stack_frame_dump : nullptr}.run(source_manager,
+                                                                                              source_id);
   if (!result) {
-    std::cout << fmt::format("Failed to interpret program. Error: {}", result.error()) << std::endl;
+    std::cout << "Failed to interpret program." << std::endl;
+    print_error(diagnostics, result.error());
   } else {
     std::cout << "Memory dump: " << std::endl;
     for (const auto& entry : result->memory.data()) {
@@ -36,7 +75,7 @@ int run_interpreter(std::string&& pascal_program) {
 
     std::cout << std::endl;
 
-    for (const auto& [name, symbol_table] : result->symbol_tables) {
+    for (const auto& symbol_table : result->semantic_model.scopes) {
       std::cout << symbol_table << std::endl;
     }
 
@@ -48,51 +87,36 @@ int run_interpreter(std::string&& pascal_program) {
   return 0;
 }
 
-int simple_main() {
-  std::string pascal_program = R"(
-PROGRAM Simple1;
-VAR
-  a: INTEGER;
-BEGIN
-  a := 10;
-END.
-)";
-  return visualise_ast(std::move(pascal_program));
-}
-
-int hard_main() {
-  std::string pascal_program = R"(
-PROGRAM Part12;
-VAR
-   a : REAL;
-
-PROCEDURE P1(f, d: INTEGER; l: REAL);
-VAR
-   b : REAL;
-   k : INTEGER;
-
-   PROCEDURE P2(c, d: INTEGER; e, f, g: REAL);
-   VAR
-      z : INTEGER;
-   BEGIN {P2}
-      z := 777.5;
-   END;  {P2}
-
-BEGIN {P1}
-  k := f + d - l;
-  b := 300.3;
-  P2(30, 20 + k, 10.35 - b, b * b, k + b - f * (d + l));
-END;  {P1}
-
-BEGIN {Part12}
-   a := 10;
-   P1(a + 10, a * a, 33.5 + 22);
-END.  {Part12}
-)";
-//  return visualise_ast(std::move(pascal_program));
-  return run_interpreter(std::move(pascal_program));
-}
+// Usage: pascal_compiler_tutorial [--ast] [--trace] <file.pas>
+// Interprets the program, or prints its AST in the DOT format if --ast is given. With --trace, every stack frame is
+// dumped when it is released.
+int main(int argc, char** argv) {
+  bool visualise = false;
+  bool trace = false;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (std::string_view{argv[i]} == "--ast") {
+      visualise = true;
+    } else if (std::string_view{argv[i]} == "--trace") {
+      trace = true;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == nullptr) {
+    std::cout << "Usage: " << argv[0] << " [--ast] [--trace] <file.pas>" << std::endl;
+    return -1;
+  }
 
-int main() {
-  return hard_main();
+  SourceManager source_manager{};
+  auto source_id = source_manager.load_file(path);
+  if (!source_id) {
+    std::cout << source_id.error() << std::endl;
+    return -1;
+  }
+  DiagnosticsEngine diagnostics{source_manager};
+  if (visualise) {
+    return visualise_ast(source_manager, *source_id, diagnostics);
+  }
+  return run_interpreter(source_manager, *source_id, diagnostics, trace);
 }
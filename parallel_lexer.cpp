@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <thread>
+#include "parallel_lexer.h"
+#include "char_scanner.h"
+
+namespace freezing::interpreter {
+
+namespace detail {
+
+// Smallest chunk that is lexed on its own thread.
+constexpr int kMinChunkSize = 1 << 20;
+
+struct LexedChunk {
+  std::vector<Token> tokens;
+  std::optional<LexerError> error;
+  int num_lines = 0;
+  // Number of lines before the chunk.
+  int first_line_number = 0;
+  // Position of the chunk's tokens in the joined tokens.
+  size_t first_token_index = 0;
+};
+
+void lex_chunk(std::string_view text, SourceId source_id, int begin, int end, LexedChunk& chunk) {
+  // Lexer stops at the end of the chunk, which is the end of a line, so it doesn't cut a token.
+  Lexer lexer{text.substr(0, end), source_id, begin};
+  auto tokens = lexer.lex_all();
+  if (!tokens) {
+    chunk.error = std::move(tokens).error();
+    return;
+  }
+  chunk.tokens = std::move(*tokens);
+  chunk.num_lines = lexer.location().line_number;
+}
+
+// Copies the chunk's tokens to their place in the joined tokens, moving their lines after the preceding chunks.
+void join_chunk(const LexedChunk& chunk, bool is_last, std::vector<Token>& tokens) {
+  // Only the last chunk's END_OF_FILE is the end of the text.
+  size_t num_tokens = is_last ? chunk.tokens.size() : chunk.tokens.size() - 1;
+  for (size_t i = 0; i < num_tokens; i++) {
+    Token token = chunk.tokens[i];
+    CharLocation location = token.location();
+    location.line_number += chunk.first_line_number;
+    token.packed_location = PackedCharLocation{location};
+    tokens[chunk.first_token_index + i] = token;
+  }
+}
+
+}
+
+std::vector<int> find_chunk_boundaries(std::string_view text, int max_num_chunks) {
+  std::vector<int> boundaries{0};
+  int size = static_cast<int>(text.size());
+  // Everything before pos is known to be outside of comments, next_open is the first '{' at or after pos.
+  int pos = 0;
+  int next_open = find_char(text, 0, '{');
+  for (int i = 1; i < max_num_chunks && pos < size; i++) {
+    int target = static_cast<int>(static_cast<int64_t>(size) * i / max_num_chunks);
+    while (true) {
+      int new_line = find_char(text, std::max(pos, target), '\n');
+      if (new_line + 1 >= size) {
+        return boundaries;
+      }
+      if (next_open > new_line) {
+        pos = new_line + 1;
+        break;
+      }
+      // The new line might be in the comment, so move past it. A comment ends at the first '}'.
+      int close = find_char(text, next_open + 1, '}');
+      if (close >= size) {
+        return boundaries;
+      }
+      pos = close + 1;
+      next_open = find_char(text, pos, '{');
+    }
+    boundaries.push_back(pos);
+  }
+  return boundaries;
+}
+
+int num_lexer_chunks(std::string_view text) {
+  int num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  return std::clamp(static_cast<int>(text.size() / detail::kMinChunkSize), 1, num_threads);
+}
+
+LexerResult<std::vector<Token>> lex_parallel(std::string_view text, SourceId source_id, int max_num_chunks) {
+  std::vector<int> boundaries = find_chunk_boundaries(text, max_num_chunks);
+  if (boundaries.size() == 1) {
+    return Lexer{text, source_id}.lex_all();
+  }
+  boundaries.push_back(static_cast<int>(text.size()));
+  int num_chunks = static_cast<int>(boundaries.size()) - 1;
+
+  std::vector<detail::LexedChunk> chunks(num_chunks);
+  std::vector<std::thread> threads;
+  threads.reserve(num_chunks - 1);
+  for (int i = 1; i < num_chunks; i++) {
+    threads.emplace_back(detail::lex_chunk, text, source_id, boundaries[i], boundaries[i + 1], std::ref(chunks[i]));
+  }
+  detail::lex_chunk(text, source_id, boundaries[0], boundaries[1], chunks[0]);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // The sequential lexer would stop at the first error, so that's the one to report.
+  for (auto& chunk : chunks) {
+    if (chunk.error) {
+      return make_error(std::move(*chunk.error));
+    }
+  }
+
+  // Each chunk ends with a new line, so its tokens are offset by the new lines of the preceding chunks.
+  size_t num_tokens = 0;
+  for (int i = 0; i < num_chunks; i++) {
+    chunks[i].first_token_index = num_tokens;
+    num_tokens += chunks[i].tokens.size() - 1;
+    if (i > 0) {
+      chunks[i].first_line_number = chunks[i - 1].first_line_number + chunks[i - 1].num_lines;
+    }
+  }
+  std::vector<Token> tokens(num_tokens + 1);
+
+  threads.clear();
+  for (int i = 1; i < num_chunks; i++) {
+    threads.emplace_back(detail::join_chunk, std::cref(chunks[i]), i + 1 == num_chunks, std::ref(tokens));
+  }
+  detail::join_chunk(chunks[0], num_chunks == 1, tokens);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return tokens;
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__PARALLEL_LEXER_H
+#define PASCAL_COMPILER_TUTORIAL__PARALLEL_LEXER_H
+
+#include <string_view>
+#include <vector>
+#include "lexer.h"
+
+namespace freezing::interpreter {
+
+// Splits the text into at most max_num_chunks chunks, each of which starts at the start of a line outside of a
+// comment, so no token spans two chunks. Returns the offsets at which the chunks start, the first one is always 0.
+std::vector<int> find_chunk_boundaries(std::string_view text, int max_num_chunks);
+
+// Number of chunks worth lexing in parallel, so that every thread gets enough text to amortize its start.
+int num_lexer_chunks(std::string_view text);
+
+// Lexes the chunks of the text on separate threads and joins their tokens. Both the tokens and the error, if any, are
+// identical to what the Lexer produces when it lexes the whole text.
+LexerResult<std::vector<Token>> lex_parallel(std::string_view text, SourceId source_id, int max_num_chunks);
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__PARALLEL_LEXER_H
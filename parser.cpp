@@ -4,55 +4,168 @@
 
 #include "parser.h"
 
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <thread>
 #include <utility>
 #include "result.h"
-#include "debug.h"
+#include "parallel_lexer.h"
+#include "ast_relabel.h"
 
 namespace freezing::interpreter {
 
 namespace detail {
 
-ParserResult<Num> parse_integer_const(IdGenerator<NodeId>& node_id_generator, const std::string& value) {
-  // TODO: Handle exceptions.
-  return Num{node_id_generator.next(), std::stoi(value)};
+struct OperatorPrecedence {
+  TokenType token_type;
+  int8_t precedence;
+};
+
+// Binary operators, all of which are left associative. Higher precedence binds tighter.
+constexpr OperatorPrecedence kBinaryOperators[] = {
+    {TokenType::PLUS, 1},
+    {TokenType::MINUS, 1},
+    {TokenType::MUL, 2},
+    {TokenType::INTEGER_DIV, 2},
+    {TokenType::REAL_DIV, 2},
+};
+
+// Prefix operators bind tighter than any binary operator.
+constexpr TokenType kPrefixOperators[] = {TokenType::PLUS, TokenType::MINUS};
+
+// Indexed by the token type, 0 if the token isn't a binary operator.
+constexpr std::array<int8_t, 256> make_binary_precedence_table() {
+  std::array<int8_t, 256> table{};
+  for (const auto& op : kBinaryOperators) {
+    table[static_cast<uint8_t>(op.token_type)] = op.precedence;
+  }
+  return table;
 }
 
-ParserResult<Num> parse_double_const(IdGenerator<NodeId>& node_id_generator, const std::string& value) {
-  // TODO: Handle exceptions.
-  return Num{node_id_generator.next(), std::stod(value)};
-}
+constexpr std::array<int8_t, 256> kBinaryPrecedenceTable = make_binary_precedence_table();
 
+constexpr int binary_precedence(TokenType token_type) {
+  return kBinaryPrecedenceTable[static_cast<uint8_t>(token_type)];
 }
 
-Parser::Parser(std::string text, std::vector<Token>&& tokens) : text_{std::move(text)}, tokens_{std::move(tokens)},
-                                                                current_token_{tokens_.begin()},
-                                                                node_id_generator{} {
+constexpr int8_t max_binary_precedence() {
+  int8_t max_precedence = 0;
+  for (const auto& op : kBinaryOperators) {
+    max_precedence = std::max(max_precedence, op.precedence);
+  }
+  return max_precedence;
 }
 
-Result<Parser, LexerError> Parser::create(std::string text) {
-  Lexer lexer{text};
-
-  std::vector<Token> tokens;
+constexpr int8_t kPrefixPrecedence = max_binary_precedence() + 1;
+// Lower than any operator, so reducing stops at the innermost open bracket.
+constexpr int8_t kOpenBracketPrecedence = 0;
 
-  while (true) {
-    auto advance_check = lexer.advance();
-    if (!advance_check) {
-      return forward_error(std::move(advance_check));
+constexpr bool is_prefix_operator(TokenType token_type) {
+  for (auto prefix_operator : kPrefixOperators) {
+    if (prefix_operator == token_type) {
+      return true;
     }
-    tokens.push_back(std::move(lexer.peek()));
-    if (tokens.back().token_type == TokenType::END_OF_FILE) {
+  }
+  return false;
+}
+
+// Declarations are split between threads only if each thread gets at least this many.
+constexpr int kMinProcedureDeclarationsPerThread = 16;
+
+std::vector<int> find_procedure_declaration_ends(const Token* tokens, int num_tokens, int index) {
+  std::vector<int> ends;
+  int num_open_procedures = 0;
+  int num_open_compound_statements = 0;
+  for (int i = index; i < num_tokens; i++) {
+    switch (tokens[i].token_type) {
+    case TokenType::PROCEDURE:
+      num_open_procedures++;
+      break;
+    case TokenType::BEGIN:
+      num_open_compound_statements++;
+      break;
+    case TokenType::END:
+      if (num_open_compound_statements == 0) {
+        return {};
+      }
+      num_open_compound_statements--;
+      if (num_open_compound_statements > 0) {
+        break;
+      }
+      // The outermost compound statement is the body of the innermost open procedure, which ends with SEMICOLON.
+      if (num_open_procedures == 0 || tokens[i + 1].token_type != TokenType::SEMICOLON) {
+        return {};
+      }
+      num_open_procedures--;
+      i++;
+      if (num_open_procedures == 0) {
+        ends.push_back(i + 1);
+        if (tokens[i + 1].token_type != TokenType::PROCEDURE) {
+          return ends;
+        }
+      }
+      break;
+    default:
       break;
     }
   }
-  assert(tokens.back().token_type == TokenType::END_OF_FILE);
-  return Parser{std::move(text), std::move(tokens)};
+  return {};
+}
+
+// Calls fn for each of the parts, all but the first on their own thread.
+template<typename T, typename Fn>
+void run_on_threads(std::vector<T>& parts, Fn fn) {
+  std::vector<std::thread> threads;
+  threads.reserve(parts.size() - 1);
+  for (size_t i = 1; i < parts.size(); i++) {
+    threads.emplace_back([&fn, &part = parts[i]]() { fn(part); });
+  }
+  fn(parts[0]);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}
+
+Parser::Parser(std::string_view text, SourceId source_id, TokenStream&& tokens, int max_num_threads,
+               std::shared_ptr<DeferredParser> deferred_parser)
+    : text_{text}, source_id_{source_id}, tokens_{std::move(tokens)}, node_id_generator{},
+      max_num_threads_{max_num_threads}, deferred_parser_{std::move(deferred_parser)} {
+}
+
+Result<Parser, LexerError> Parser::create(const SourceManager& source_manager, SourceId source_id,
+                                          ParserOptions options) {
+  std::string_view text = source_manager.text(source_id);
+  auto tokens = lex_parallel(text, source_id, num_lexer_chunks(text));
+  if (!tokens) {
+    return forward_error(std::move(tokens));
+  }
+  if (options.lazy_procedure_bodies) {
+    // Skipping the bodies only scans the tokens, which isn't worth splitting between threads. The tokens are owned
+    // by the deferred parser, since they're needed for as long as there are blocks left to parse.
+    auto deferred_parser = std::make_shared<DeferredParser>(text, source_id, std::move(*tokens));
+    const auto& deferred_tokens = deferred_parser->tokens();
+    return Parser{text, source_id, TokenStream{deferred_tokens.data(), static_cast<int>(deferred_tokens.size()), 0},
+                  1, std::move(deferred_parser)};
+  }
+  if (options.max_num_threads == 0) {
+    options.max_num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  return Parser{text, source_id, TokenStream{std::move(*tokens)}, options.max_num_threads};
+}
+
+Parser Parser::create_streaming(const SourceManager& source_manager, SourceId source_id) {
+  std::string_view text = source_manager.text(source_id);
+  return Parser{text, source_id, TokenStream{text, source_id}, 1};
 }
 
 ParserResult<Program> Parser::parse_program() {
   if (!is_current_token(TokenType::PROGRAM)) {
-    return unexpected_token_error(TokenType::PROGRAM, *current_token_);
+    return unexpected_token_error(TokenType::PROGRAM, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   auto identifier = parse_identifier();
   if (!identifier) {
@@ -60,9 +173,9 @@ ParserResult<Program> Parser::parse_program() {
   }
 
   if (!is_current_token(TokenType::SEMICOLON)) {
-    return unexpected_token_error(TokenType::SEMICOLON, *current_token_);
+    return unexpected_token_error(TokenType::SEMICOLON, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   auto block = parse_block();
   if (!block) {
@@ -70,10 +183,15 @@ ParserResult<Program> Parser::parse_program() {
   }
 
   if (!is_current_token(TokenType::DOT)) {
-    return unexpected_token_error(TokenType::DOT, *current_token_);
+    return unexpected_token_error(TokenType::DOT, tokens_.current());
+  }
+  tokens_.advance();
+  NodeId program_id = node_id_generator.next();
+  if (deferred_parser_) {
+    deferred_parser_->set_next_node_id(program_id + 1);
   }
-  current_token_++;
-  return Program{node_id_generator.next(), std::move(*identifier), std::move(*block)};
+  return Program{program_id, std::move(*identifier), std::move(*block), std::move(arena_),
+                 std::move(deferred_parser_)};
 }
 
 ParserResult<Block> Parser::parse_block() {
@@ -88,7 +206,7 @@ ParserResult<Block> Parser::parse_block() {
     variable_declarations = std::move(*variable_declarations_result);
   }
 
-  if (current_token_->token_type == TokenType::PROCEDURE) {
+  if (tokens_.current().token_type == TokenType::PROCEDURE) {
     auto procedure_declarations_result = parse_procedure_declarations();
     if (!procedure_declarations_result) {
       return forward_error(std::move(procedure_declarations_result));
@@ -107,9 +225,9 @@ ParserResult<Block> Parser::parse_block() {
 
 ParserResult<std::vector<VarDecl>> Parser::parse_variable_declarations() {
   if (!is_current_token(TokenType::VAR)) {
-    return unexpected_token_error(TokenType::VAR, *current_token_);
+    return unexpected_token_error(TokenType::VAR, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
   std::vector<VarDecl> declarations;
   while (true) {
     auto variable_declaration = parse_variable_declaration();
@@ -117,9 +235,9 @@ ParserResult<std::vector<VarDecl>> Parser::parse_variable_declarations() {
       return forward_error(std::move(variable_declaration));
     }
     if (!is_current_token(TokenType::SEMICOLON)) {
-      return unexpected_token_error(TokenType::SEMICOLON, *current_token_);
+      return unexpected_token_error(TokenType::SEMICOLON, tokens_.current());
     }
-    current_token_++;
+    tokens_.advance();
     declarations.push_back(std::move(*variable_declaration));
 
     if (!is_current_token(TokenType::ID)) {
@@ -142,7 +260,7 @@ ParserResult<VarDecl> Parser::parse_variable_declaration() {
     if (!is_current_token(TokenType::COMMA)) {
       break;
     }
-    current_token_++;
+    tokens_.advance();
 
     auto new_variable = parse_variable();
     if (!new_variable) {
@@ -152,9 +270,9 @@ ParserResult<VarDecl> Parser::parse_variable_declaration() {
   }
 
   if (!is_current_token(TokenType::COLON)) {
-    return unexpected_token_error(TokenType::COLON, *current_token_);
+    return unexpected_token_error(TokenType::COLON, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   auto type_spec = parse_type();
   if (!type_spec) {
@@ -164,6 +282,14 @@ ParserResult<VarDecl> Parser::parse_variable_declaration() {
 }
 
 ParserResult<std::vector<ProcedureDecl>> Parser::parse_procedure_declarations() {
+  // Only the top level declarations are split between the threads, each one parses the nested declarations itself.
+  if (max_num_threads_ > 1) {
+    auto procedure_declarations = parse_procedure_declarations_in_parallel(std::exchange(max_num_threads_, 1));
+    if (procedure_declarations) {
+      return std::move(*procedure_declarations);
+    }
+  }
+
   std::vector<ProcedureDecl> procedure_declarations;
   while (is_current_token(TokenType::PROCEDURE)) {
     auto procedure_declaration = parse_procedure_declaration();
@@ -175,11 +301,83 @@ ParserResult<std::vector<ProcedureDecl>> Parser::parse_procedure_declarations()
   return procedure_declarations;
 }
 
+std::optional<std::vector<ProcedureDecl>> Parser::parse_procedure_declarations_in_parallel(int max_num_threads) {
+  const Token* tokens = tokens_.tokens();
+  int num_tokens = tokens_.num_tokens();
+  std::vector<int> ends = detail::find_procedure_declaration_ends(tokens, num_tokens, tokens_.index());
+  int num_declarations = static_cast<int>(ends.size());
+  int num_threads = std::min(max_num_threads, num_declarations / detail::kMinProcedureDeclarationsPerThread);
+  if (num_threads <= 1) {
+    return std::nullopt;
+  }
+
+  // Each thread parses consecutive declarations, with node ids from 0, into its own arena.
+  struct ParsedDeclarations {
+    int begin;
+    int end;
+    std::vector<ProcedureDecl> procedure_declarations;
+    AstArena arena;
+    int num_node_ids = 0;
+    bool succeeded = false;
+  };
+  std::vector<ParsedDeclarations> parsed(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    parsed[i].begin = num_declarations * i / num_threads;
+    parsed[i].end = num_declarations * (i + 1) / num_threads;
+  }
+  int first_index = tokens_.index();
+  auto parse = [&](ParsedDeclarations& part) {
+    int index = part.begin == 0 ? first_index : ends[part.begin - 1];
+    Parser parser{text_, source_id_, TokenStream{tokens, num_tokens, index}, 1};
+    for (int i = part.begin; i < part.end; i++) {
+      auto procedure_declaration = parser.parse_procedure_declaration();
+      // The pre-scan can be fooled by a malformed declaration, so it must end where the pre-scan expects.
+      if (!procedure_declaration || parser.tokens_.index() != ends[i]) {
+        return;
+      }
+      part.procedure_declarations.push_back(std::move(*procedure_declaration));
+    }
+    part.arena = std::move(parser.arena_);
+    part.num_node_ids = parser.node_id_generator.peek();
+    part.succeeded = true;
+  };
+  detail::run_on_threads(parsed, parse);
+  for (const auto& part : parsed) {
+    if (!part.succeeded) {
+      return std::nullopt;
+    }
+  }
+
+  // Ids follow the ids of the preceding nodes, which is what the sequential parser would have assigned.
+  std::vector<NodeId> offsets(num_threads);
+  NodeId next_id = node_id_generator.peek();
+  for (int i = 0; i < num_threads; i++) {
+    offsets[i] = next_id;
+    next_id += parsed[i].num_node_ids;
+  }
+  detail::run_on_threads(parsed, [&](ParsedDeclarations& part) {
+    for (auto& procedure_declaration : part.procedure_declarations) {
+      shift_node_ids(procedure_declaration, offsets[&part - parsed.data()]);
+    }
+  });
+
+  std::vector<ProcedureDecl> procedure_declarations;
+  procedure_declarations.reserve(num_declarations);
+  for (auto& part : parsed) {
+    std::move(part.procedure_declarations.begin(), part.procedure_declarations.end(),
+              std::back_inserter(procedure_declarations));
+    arena_.adopt(std::move(part.arena));
+  }
+  node_id_generator = IdGenerator<NodeId>{next_id};
+  tokens_.seek(ends.back());
+  return procedure_declarations;
+}
+
 ParserResult<ProcedureDecl> Parser::parse_procedure_declaration() {
   if (!is_current_token(TokenType::PROCEDURE)) {
-    return unexpected_token_error(TokenType::PROCEDURE, *current_token_);
+    return unexpected_token_error(TokenType::PROCEDURE, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   auto name = parse_identifier();
   if (!name) {
@@ -189,34 +387,95 @@ ParserResult<ProcedureDecl> Parser::parse_procedure_declaration() {
   // (LPAREN formal_parameter_list RPAREN)?
   std::vector<Param> params;
   if (is_current_token(TokenType::OPEN_BRACKET)) {
-    current_token_++;
+    tokens_.advance();
     auto params_result = parse_formal_parameter_list();
     if (!params_result) {
       return forward_error(std::move(params_result));
     }
     params = std::move(*params_result);
     if (!is_current_token(TokenType::CLOSED_BRACKET)) {
-      return unexpected_token_error(TokenType::CLOSED_BRACKET, *current_token_);
+      return unexpected_token_error(TokenType::CLOSED_BRACKET, tokens_.current());
     }
-    current_token_++;
+    tokens_.advance();
   }
 
   if (!is_current_token(TokenType::SEMICOLON)) {
-    return unexpected_token_error(TokenType::SEMICOLON, *current_token_);
+    return unexpected_token_error(TokenType::SEMICOLON, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
-  auto block = parse_block();
-  if (!block) {
-    return forward_error(std::move(block));
+  const LazyBlock* lazy_block;
+  if (deferred_parser_) {
+    auto skipped_block = skip_block();
+    if (!skipped_block) {
+      return forward_error(std::move(skipped_block));
+    }
+    lazy_block = *skipped_block;
+  } else {
+    auto block = parse_block();
+    if (!block) {
+      return forward_error(std::move(block));
+    }
+    lazy_block = arena_.create<LazyBlock>(arena_.create<Block>(std::move(*block)));
   }
 
   if (!is_current_token(TokenType::SEMICOLON)) {
-    return unexpected_token_error(TokenType::SEMICOLON, *current_token_);
+    return unexpected_token_error(TokenType::SEMICOLON, tokens_.current());
   }
-  current_token_++;
-  return ProcedureDecl{node_id_generator.next(), std::move(*name), std::move(params),
-                       std::make_shared<Block>(std::move(*block))};
+  tokens_.advance();
+  return ProcedureDecl{node_id_generator.next(), std::move(*name), std::move(params), lazy_block};
+}
+
+ParserResult<const LazyBlock*> Parser::skip_block() {
+  // Nested procedures are skipped together with the block, so the compound statement that closes the block is the
+  // one that closes when no nested procedure is open.
+  const Token* tokens = tokens_.tokens();
+  int begin = tokens_.index();
+  int num_open_procedures = 0;
+  int num_open_compound_statements = 0;
+  int num_open_brackets = 0;
+  for (int i = begin; i < tokens_.num_tokens(); i++) {
+    bool is_balanced = true;
+    switch (tokens[i].token_type) {
+    case TokenType::PROCEDURE:
+      num_open_procedures++;
+      break;
+    case TokenType::BEGIN:
+      is_balanced = num_open_brackets == 0;
+      num_open_compound_statements++;
+      break;
+    case TokenType::END:
+      is_balanced = num_open_brackets == 0 && num_open_compound_statements > 0;
+      num_open_compound_statements--;
+      if (is_balanced && num_open_compound_statements == 0) {
+        if (num_open_procedures == 0) {
+          tokens_.seek(i + 1);
+          return arena_.create<LazyBlock>(deferred_parser_.get(), begin, i + 1);
+        }
+        num_open_procedures--;
+      }
+      break;
+    case TokenType::OPEN_BRACKET:
+      num_open_brackets++;
+      break;
+    case TokenType::CLOSED_BRACKET:
+      is_balanced = num_open_brackets > 0;
+      num_open_brackets--;
+      break;
+    case TokenType::END_OF_FILE:
+      is_balanced = false;
+      break;
+    default:
+      break;
+    }
+    if (!is_balanced) {
+      tokens_.seek(i);
+      return parser_error(DiagnosticCode::UNBALANCED_PROCEDURE_BODY,
+                          {fmt::format("{}", tokens[i].token_type), std::string{tokens[i].lexeme(text_)}});
+    }
+  }
+  assert(false && "The last token is END_OF_FILE.");
+  return parser_error(DiagnosticCode::UNBALANCED_PROCEDURE_BODY, {});
 }
 
 ParserResult<std::vector<Param>> Parser::parse_formal_parameter_list() {
@@ -227,7 +486,7 @@ ParserResult<std::vector<Param>> Parser::parse_formal_parameter_list() {
   std::vector<Param> parameters = std::move(*formal_parameters);
 
   if (is_current_token(TokenType::SEMICOLON)) {
-    current_token_++;
+    tokens_.advance();
     auto list = parse_formal_parameter_list();
     if (!list) {
       return forward_error(std::move(list));
@@ -237,7 +496,7 @@ ParserResult<std::vector<Param>> Parser::parse_formal_parameter_list() {
     }
   }
 
-  return std::move(parameters);
+  return parameters;
 }
 
 ParserResult<std::vector<Param>> Parser::parse_formal_parameters() {
@@ -249,7 +508,7 @@ ParserResult<std::vector<Param>> Parser::parse_formal_parameters() {
   identifiers.push_back(std::move(*id));
 
   while (is_current_token(TokenType::COMMA)) {
-    current_token_++;
+    tokens_.advance();
     id = parse_identifier();
     if (!id) {
       return forward_error(std::move(id));
@@ -258,9 +517,9 @@ ParserResult<std::vector<Param>> Parser::parse_formal_parameters() {
   }
 
   if (!is_current_token(TokenType::COLON)) {
-    return unexpected_token_error(TokenType::COLON, *current_token_);
+    return unexpected_token_error(TokenType::COLON, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   auto type = parse_type();
   if (!type) {
@@ -276,19 +535,20 @@ ParserResult<std::vector<Param>> Parser::parse_formal_parameters() {
 
 ParserResult<TokenType> Parser::parse_type() {
   if (!is_current_token(TokenType::INTEGER) && !is_current_token(TokenType::REAL)) {
-    return make_error(ParserError{
-        fmt::format("Expected type 'INTEGER' or 'REAL', but got token: '{}'", *current_token_)});
+    return parser_error(DiagnosticCode::EXPECTED_TYPE,
+                        {fmt::format("{}", tokens_.current().token_type),
+                         std::string{tokens_.current().lexeme(text_)}});
   }
-  TokenType token_type = current_token_->token_type;
-  current_token_++;
+  TokenType token_type = tokens_.current().token_type;
+  tokens_.advance();
   return token_type;
 }
 
 ParserResult<CompoundStatement> Parser::parse_compound_statement() {
   if (!is_current_token(TokenType::BEGIN)) {
-    return unexpected_token_error(TokenType::BEGIN, *current_token_);
+    return unexpected_token_error(TokenType::BEGIN, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   auto statements = parse_statement_list();
   if (!statements) {
@@ -296,9 +556,9 @@ ParserResult<CompoundStatement> Parser::parse_compound_statement() {
   }
 
   if (!is_current_token(TokenType::END)) {
-    return unexpected_token_error(TokenType::END, *current_token_);
+    return unexpected_token_error(TokenType::END, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
   return CompoundStatement{node_id_generator.next(), std::move(*statements)};
 }
 
@@ -314,7 +574,7 @@ ParserResult<std::vector<Statement>> Parser::parse_statement_list() {
   }
 
   while (is_current_token(TokenType::SEMICOLON)) {
-    current_token_++;
+    tokens_.advance();
 
     auto statement = parse_statement();
     if (!statement) {
@@ -330,7 +590,7 @@ ParserResult<Statement> Parser::parse_statement() {
     return parse_compound_statement();
   } else if (is_current_token(TokenType::ID)) {
     // Next element must be at least END_OF_FILE, so it's safe to check its type.
-    if ((current_token_ + 1)->token_type == TokenType::OPEN_BRACKET) {
+    if (tokens_.lookahead(1).token_type == TokenType::OPEN_BRACKET) {
       return parse_procedure_call();
     }
 
@@ -347,9 +607,9 @@ ParserResult<AssignmentStatement> Parser::parse_assignment_statement() {
   }
 
   if (!is_current_token(TokenType::ASSIGN)) {
-    return unexpected_token_error(TokenType::ASSIGN, *current_token_);
+    return unexpected_token_error(TokenType::ASSIGN, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   auto expr = parse_expr();
   if (!expr) {
@@ -362,15 +622,15 @@ ParserResult<AssignmentStatement> Parser::parse_assignment_statement() {
 ParserResult<ProcedureCall> Parser::parse_procedure_call() {
   // proccall_statement : ID LPAREN (expr (COMMA expr)*)? RPAREN
   if (!is_current_token(TokenType::ID)) {
-    return unexpected_token_error(TokenType::ID, *current_token_);
+    return unexpected_token_error(TokenType::ID, tokens_.current());
   }
-  std::string name = *current_token_->value;
-  current_token_++;
+  Identifier name = Identifier::from_id(tokens_.current().value.identifier);
+  tokens_.advance();
 
   if (!is_current_token(TokenType::OPEN_BRACKET)) {
-    return unexpected_token_error(TokenType::OPEN_BRACKET, *current_token_);
+    return unexpected_token_error(TokenType::OPEN_BRACKET, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   // Parse arguments.
   std::vector<ExpressionNode> arguments;
@@ -384,23 +644,23 @@ ParserResult<ProcedureCall> Parser::parse_procedure_call() {
     if (!is_current_token(TokenType::COMMA)) {
       break;
     }
-    current_token_++;
+    tokens_.advance();
   }
 
   if (!is_current_token(TokenType::CLOSED_BRACKET)) {
-    return unexpected_token_error(TokenType::CLOSED_BRACKET, *current_token_);
+    return unexpected_token_error(TokenType::CLOSED_BRACKET, tokens_.current());
   }
-  current_token_++;
+  tokens_.advance();
 
   return ProcedureCall{node_id_generator.next(), std::move(name), std::move(arguments)};
 }
 
 ParserResult<Identifier> Parser::parse_identifier() {
   if (!is_current_token(TokenType::ID)) {
-    return unexpected_token_error(TokenType::ID, *current_token_);
+    return unexpected_token_error(TokenType::ID, tokens_.current());
   }
-  Identifier id = std::move(*current_token_->value);
-  current_token_++;
+  Identifier id = Identifier::from_id(tokens_.current().value.identifier);
+  tokens_.advance();
   return id;
 }
 
@@ -418,127 +678,154 @@ Empty Parser::parse_empty() {
 }
 
 ParserResult<ExpressionNode> Parser::parse_expr() {
-  auto first_term = parse_term();
-  if (!first_term) {
-    return forward_error(std::move(first_term));
-  }
-  ExpressionNode result = std::move(*first_term);
+  // The stacks are shared with enclosing expressions, if any, so only the part above the bases belongs to this one.
+  size_t operands_base = operands_.size();
+  size_t operators_base = operators_.size();
+  auto discard = [&]() {
+    operands_.erase(operands_.begin() + operands_base, operands_.end());
+    operators_.erase(operators_.begin() + operators_base, operators_.end());
+  };
 
-  while (is_current_token(TokenType::PLUS) || is_current_token(TokenType::MINUS)) {
-    Token op_token = *current_token_;
-    current_token_++;
-
-    auto right = parse_term();
-    if (!right) {
-      return forward_error(std::move(right));
+  while (true) {
+    // An operand is expected, optionally preceded by prefix operators and open brackets.
+    TokenType token_type = tokens_.current().token_type;
+    if (detail::is_prefix_operator(token_type)) {
+      operators_.push_back(PendingOperator{token_type, detail::kPrefixPrecedence});
+      tokens_.advance();
+      continue;
     }
-
-    result = BinOp{node_id_generator.next(),
-                   op_token.token_type,
-                   std::make_unique<ExpressionNode>(std::move(result)),
-                   std::make_unique<ExpressionNode>(std::move(*right))};
-  }
-  return result;
-}
-
-ParserResult<ExpressionNode> Parser::parse_term() {
-  auto first_factor = parse_factor();
-  if (!first_factor) {
-    return forward_error(std::move(first_factor));
-  }
-
-  ExpressionNode result = std::move(*first_factor);
-
-  while (is_current_token(TokenType::MUL) || is_current_token(TokenType::INTEGER_DIV)
-      || is_current_token(TokenType::REAL_DIV)) {
-    auto op_token = *current_token_;
-    current_token_++;
-
-    auto right = parse_factor();
-    if (!right) {
-      return forward_error(std::move(right));
+    if (token_type == TokenType::OPEN_BRACKET) {
+      operators_.push_back(PendingOperator{token_type, detail::kOpenBracketPrecedence});
+      tokens_.advance();
+      continue;
     }
-
-    result = BinOp{node_id_generator.next(),
-                   op_token.token_type,
-                   std::make_unique<ExpressionNode>(std::move(result)),
-                   std::make_unique<ExpressionNode>(std::move(*right))};
-  }
-  return result;
-}
-
-ParserResult<ExpressionNode> Parser::parse_factor() {
-  // PLUS factor
-  // MINUS factor
-  if (is_current_token(TokenType::PLUS) || is_current_token(TokenType::MINUS)) {
-    auto op_type = current_token_->token_type;
-    current_token_++;
-
-    auto factor = parse_factor();
-    if (!factor) {
-      return forward_error(std::move(factor));
+    auto operand = parse_operand();
+    if (!operand) {
+      discard();
+      return forward_error(std::move(operand));
     }
-
-    return UnaryOp{node_id_generator.next(), op_type, std::make_unique<ExpressionNode>(std::move(*factor))};
-  }
-
-  // LPAREN expr RPAREN
-  if (is_current_token(TokenType::OPEN_BRACKET)) {
-    current_token_++;
-
-    auto expression = parse_expr();
-    if (!expression) {
-      return forward_error(std::move(expression));
+    operands_.push_back(std::move(*operand));
+
+    // Closes the brackets that follow the operand, until either a binary operator or the end of the expression.
+    while (true) {
+      token_type = tokens_.current().token_type;
+      int precedence = detail::binary_precedence(token_type);
+      if (precedence > 0) {
+        // Operators of the same precedence are left associative.
+        reduce_operators(operators_base, precedence);
+        operators_.push_back(PendingOperator{token_type, static_cast<int8_t>(precedence)});
+        tokens_.advance();
+        break;
+      }
+
+      reduce_operators(operators_base, detail::kOpenBracketPrecedence + 1);
+      if (operators_.size() == operators_base) {
+        assert(operands_.size() == operands_base + 1);
+        ExpressionNode result = std::move(operands_.back());
+        operands_.pop_back();
+        return result;
+      }
+      // Only the open bracket is left on top of the stack.
+      if (token_type != TokenType::CLOSED_BRACKET) {
+        discard();
+        return unexpected_token_error(TokenType::CLOSED_BRACKET, tokens_.current());
+      }
+      operators_.pop_back();
+      tokens_.advance();
     }
+  }
+}
 
-    // Check that the next token is CLOSED_BRACKET
-    if (!is_current_token(TokenType::CLOSED_BRACKET)) {
-      return unexpected_token_error(TokenType::CLOSED_BRACKET, *current_token_);
+void Parser::reduce_operators(size_t operators_base, int min_precedence) {
+  while (operators_.size() > operators_base && operators_.back().precedence >= min_precedence) {
+    PendingOperator op = operators_.back();
+    operators_.pop_back();
+    ExpressionNode operand = std::move(operands_.back());
+    operands_.pop_back();
+    if (op.precedence == detail::kPrefixPrecedence) {
+      operands_.push_back(UnaryOp{node_id_generator.next(), op.token_type,
+                                  arena_.create<ExpressionNode>(std::move(operand))});
+    } else {
+      ExpressionNode left = std::move(operands_.back());
+      operands_.pop_back();
+      operands_.push_back(BinOp{node_id_generator.next(),
+                                op.token_type,
+                                arena_.create<ExpressionNode>(std::move(left)),
+                                arena_.create<ExpressionNode>(std::move(operand))});
     }
-    current_token_++;
-    return expression;
   }
+}
 
+ParserResult<ExpressionNode> Parser::parse_operand() {
   // INTEGER_CONST
   // REAL_CONST
   // ID
   if (is_current_token(TokenType::INTEGER_CONST)) {
-    auto value = *current_token_->value;
-    current_token_++;
-    return detail::parse_integer_const(node_id_generator, value);
+    int value = static_cast<int>(tokens_.current().value.integer);
+    tokens_.advance();
+    return Num{node_id_generator.next(), value};
   } else if (is_current_token(TokenType::REAL_CONST)) {
-    auto value = *current_token_->value;
-    current_token_++;
-    return detail::parse_double_const(node_id_generator, value);
+    double value = tokens_.current().value.real;
+    tokens_.advance();
+    return Num{node_id_generator.next(), value};
   } else if (is_current_token(TokenType::ID)) {
     return parse_variable();
   } else {
-    return make_error(ParserError{fmt::format("Unexpected token {} found while trying to parse factor.\n{}",
-                                              current_token_->token_type,
-                                              debug_output(text_, current_token_->location))});
+    return parser_error(DiagnosticCode::UNEXPECTED_TOKEN_IN_FACTOR,
+                        {fmt::format("{}", tokens_.current().token_type)});
   }
 }
-Error<ParserError> Parser::unexpected_token_error(const TokenType token_type, const Token& actual) {
-  return make_error(ParserError{fmt::format("Unexpected token found. Expected: {}. Actual: {}.\n{}",
-                                            token_type,
-                                            actual,
-                                            debug_output(text_, current_token_->location))});
+
+const ParserErrorsT& Parser::error(ErrorId error_id) const {
+  return errors_.get(error_id);
+}
+
+Error<ErrorId> Parser::unexpected_token_error(const TokenType token_type, const Token& actual) {
+  return parser_error(DiagnosticCode::UNEXPECTED_TOKEN,
+                      {fmt::format("{}", token_type), fmt::format("{}", actual.token_type),
+                       std::string{actual.lexeme(text_)}});
+}
+
+Error<ErrorId> Parser::parser_error(DiagnosticCode code, std::vector<std::string> arguments) {
+  // Whatever the parser expected, the actual problem is that the current token couldn't be lexed.
+  if (const LexerError* lexer_error = tokens_.error()) {
+    return errors_.add(*lexer_error);
+  }
+  return errors_.add(ParserError{Diagnostic{code, source_id_, tokens_.current().offset, std::move(arguments)}});
 }
 
 bool Parser::is_current_token(TokenType token_type) const {
-  return current_token_->token_type == token_type;
+  return tokens_.current().token_type == token_type;
 }
 
-Parser::Parser(Parser&& parser) noexcept {
-  *this = std::move(parser);
+DeferredParser::DeferredParser(std::string_view text, SourceId source_id, std::vector<Token>&& tokens)
+    : text_{text}, source_id_{source_id}, tokens_{std::move(tokens)} {}
+
+const std::vector<Token>& DeferredParser::tokens() const {
+  return tokens_;
 }
 
-Parser& Parser::operator=(Parser&& parser) noexcept {
-  text_ = std::move(parser.text_);
-  tokens_ = std::move(parser.tokens_);
-  current_token_ = tokens_.begin();
-  node_id_generator = std::move(parser.node_id_generator);
-  return *this;
+void DeferredParser::set_next_node_id(NodeId node_id) {
+  node_id_generator_ = IdGenerator<NodeId>{node_id};
 }
 
-}
\ No newline at end of file
+Result<const Block*, Diagnostic> DeferredParser::parse_block(int begin, int end) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  // Nested procedure blocks are skipped again, to be parsed once they're needed themselves.
+  Parser parser{text_, source_id_, TokenStream{tokens_.data(), static_cast<int>(tokens_.size()), begin}, 1,
+                shared_from_this()};
+  parser.node_id_generator = node_id_generator_;
+  auto block = parser.parse_block();
+  if (block && parser.tokens_.index() != end) {
+    // The block is balanced, but it isn't what the parser expects, e.g. it has two compound statements.
+    block = parser.unexpected_token_error(TokenType::SEMICOLON, parser.tokens_.current());
+  }
+  if (!block) {
+    return make_error(std::visit([](const auto& error) { return error.diagnostic; }, parser.error(block.error())));
+  }
+  node_id_generator_ = parser.node_id_generator;
+  arena_.adopt(std::move(parser.arena_));
+  return arena_.create<Block>(std::move(*block));
+}
+
+}
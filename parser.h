@@ -6,22 +6,48 @@
 #define PASCAL_COMPILER_TUTORIAL__PARSER_H
 
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include "lexer.h"
 #include "ast.h"
 #include "id_generator.h"
+#include "token_stream.h"
+#include "error_store.h"
 
 namespace freezing::interpreter {
 
 struct ParserError {
-  std::string message;
+  Diagnostic diagnostic;
 
   friend std::ostream& operator<<(std::ostream& os, const ParserError& e) {
-    return os << "ParserError: " << e.message;
+    return os << "ParserError: " << e.diagnostic;
   }
 };
 
+using ParserErrorsT = std::variant<ParserError, LexerError>;
+
+// The error is in the parser's error store, see Parser::error().
 template<typename T>
-using ParserResult = Result<T, std::variant<ParserError, LexerError>>;
+using ParserResult = Result<T, ErrorId>;
+
+struct ParserOptions {
+  // Threads that may parse the top level procedure declarations, one per hardware thread if it's 0.
+  int max_num_threads = 0;
+  // Procedure bodies are only checked to be balanced when the program is parsed, and they're parsed once they're
+  // first needed, see LazyBlock.
+  bool lazy_procedure_bodies = false;
+};
+
+class DeferredParser;
+
+namespace detail {
+
+// Finds where the consecutive procedure declarations that start at the index end, by matching BEGIN and END.
+// Returns the index after each declaration, or nothing if the tokens aren't structured as expected.
+std::vector<int> find_procedure_declaration_ends(const Token* tokens, int num_tokens, int index);
+
+}
 
 // Parser that implements the following grammar:
 //
@@ -59,6 +85,9 @@ using ParserResult = Result<T, std::variant<ParserError, LexerError>>;
 //
 //    empty :
 //
+//    Expressions are parsed by precedence climbing over explicit stacks, driven by the operator tables in parser.cpp,
+//    so neither the nesting depth nor the number of precedence levels adds to the native stack:
+//
 //    expr : term ((PLUS | MINUS) term)*
 //
 //    term : factor ((MUL | INTEGER_DIV | FLOAT_DIV) factor)*
@@ -73,14 +102,18 @@ using ParserResult = Result<T, std::variant<ParserError, LexerError>>;
 //    variable: ID
 class Parser {
 public:
-  // Custom move constructor and move assignment are required because internally the parser stores vector const_iterator,
-  // which becomes invalid after move.
-  Parser(Parser&& parser) noexcept;
-  Parser& operator=(Parser&& parser) noexcept;
-
-  static Result<Parser, LexerError> create(std::string text);
+  // Lexes the whole text before parsing, so lexer errors are reported upfront. Large texts are lexed in parallel.
+  // Many top level procedure declarations are parsed in parallel as well, unless the bodies are parsed lazily.
+  // The AST, including the node ids, is the same as when parsed sequentially.
+  static Result<Parser, LexerError> create(const SourceManager& source_manager, SourceId source_id,
+                                           ParserOptions options = {});
+  // Lexes the tokens as the parser consumes them, so only the lookahead is kept in memory. Lexer errors are reported
+  // when the parser reaches the token that couldn't be lexed.
+  static Parser create_streaming(const SourceManager& source_manager, SourceId source_id);
 
   ParserResult<Program> parse_program();
+  const ParserErrorsT& error(ErrorId error_id) const;
+
   ParserResult<Block> parse_block();
   ParserResult<std::vector<VarDecl>> parse_variable_declarations();
   ParserResult<VarDecl> parse_variable_declaration();
@@ -97,22 +130,76 @@ public:
   ParserResult<ProcedureCall> parse_procedure_call();
   Empty parse_empty();
   ParserResult<ExpressionNode> parse_expr();
-  ParserResult<ExpressionNode> parse_term();
-  ParserResult<ExpressionNode> parse_factor();
+  // INTEGER_CONST, REAL_CONST or variable.
+  ParserResult<ExpressionNode> parse_operand();
   ParserResult<Identifier> parse_identifier();
   ParserResult<Variable> parse_variable();
 
 private:
-  std::string text_;
-  // Contains at least END_OF_FILE token, which is always the last one.
-  std::vector<Token> tokens_;
-  std::vector<Token>::const_iterator current_token_;
+  // Owned by the SourceManager, which must outlive the parser.
+  std::string_view text_;
+  SourceId source_id_;
+  // Ends with END_OF_FILE token, which is repeated once it's reached.
+  TokenStream tokens_;
   IdGenerator<NodeId> node_id_generator;
+  // Nodes are allocated here while parsing, and the arena is handed over to the Program once it's parsed.
+  AstArena arena_;
+  ErrorStore<ParserErrorsT> errors_;
+  // Operator not yet applied by parse_expr(). Prefix operators and open brackets have their own precedences.
+  struct PendingOperator {
+    TokenType token_type;
+    int8_t precedence;
+  };
+  // Stacks of parse_expr(), kept between expressions to reuse their memory.
+  std::vector<ExpressionNode> operands_;
+  std::vector<PendingOperator> operators_;
+
+  // Threads that may parse the top level procedure declarations, 1 if they're parsed sequentially.
+  int max_num_threads_;
+  // Parses the procedure blocks that are skipped, null unless they're parsed lazily. Handed over to the Program.
+  std::shared_ptr<DeferredParser> deferred_parser_;
+
+  friend class DeferredParser;
+  friend class IncrementalParser;
 
-  explicit Parser(std::string text, std::vector<Token>&& tokens);
+  Parser(std::string_view text, SourceId source_id, TokenStream&& tokens, int max_num_threads,
+         std::shared_ptr<DeferredParser> deferred_parser = nullptr);
 
-  Error<ParserError> unexpected_token_error(TokenType token_type, const Token& actual);
+  // Checks that the procedure block that starts at the current token is balanced, and skips it.
+  ParserResult<const LazyBlock*> skip_block();
+  // Parses the procedure declarations that start at the current token on separate threads. Returns nullopt, without
+  // consuming any tokens, if they're too few or they can't be parsed, in which case the sequential parser is expected
+  // to find the error.
+  std::optional<std::vector<ProcedureDecl>> parse_procedure_declarations_in_parallel(int max_num_threads);
+
+  Error<ErrorId> unexpected_token_error(TokenType token_type, const Token& actual);
+  // Reports the error at the current token, or the lexer error instead, if the current token couldn't be lexed.
+  Error<ErrorId> parser_error(DiagnosticCode code, std::vector<std::string> arguments);
   bool is_current_token(TokenType token_type) const;
+  // Applies the operators above the base, while their precedence is at least min_precedence.
+  void reduce_operators(size_t operators_base, int min_precedence);
+};
+
+// Parses the procedure blocks that were skipped by the lazy parser, once they're needed. It owns the tokens and the
+// nodes of those blocks, and it's owned by the Program.
+class DeferredParser : public std::enable_shared_from_this<DeferredParser> {
+public:
+  DeferredParser(std::string_view text, SourceId source_id, std::vector<Token>&& tokens);
+
+  const std::vector<Token>& tokens() const;
+  // Nodes of the skipped blocks are numbered after the nodes that were parsed upfront.
+  void set_next_node_id(NodeId node_id);
+  // Parses the block that spans tokens [begin, end). Blocks are parsed one at a time, so the nodes are numbered in
+  // the order in which the blocks are needed.
+  Result<const Block*, Diagnostic> parse_block(int begin, int end);
+
+private:
+  std::string_view text_;
+  SourceId source_id_;
+  std::vector<Token> tokens_;
+  std::mutex mutex_;
+  AstArena arena_;
+  IdGenerator<NodeId> node_id_generator_;
 };
 
 }
@@ -29,7 +29,7 @@ template<typename E>
 using Error = tl::unexpected<E>;
 
 template<typename E>
-Error<E> make_error(E&& e) {
+Error<typename std::decay<E>::type> make_error(E&& e) {
   return Error<typename std::decay<E>::type>(std::forward<E>(e));
 }
 
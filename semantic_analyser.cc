@@ -2,96 +2,193 @@
 // Created by nikola on 3/20/2021.
 //
 
+#include <cassert>
 #include "semantic_analyser.h"
 
 namespace freezing::interpreter {
 
-Result<std::map<std::string, SymbolTable>,
-       std::vector<SemanticAnalysisError>> SemanticAnalyser::analyse(const std::string& text,
-                                                                     const Program& program) const {
-  // Current scope is first initialized in the program_post callback.
-  // It is safe to assume it's always present while traversing AST.
-  std::optional<std::string> current_scope;
-  std::map<std::string, SymbolTable> scopes;
-  std::map<std::string, std::string> parent_scopes;
-  std::vector<SemanticAnalysisError> errors;
+namespace detail {
+
+// Looks up the symbol for each scope between the given one and the root of the tree.
+// Returns the symbol found by find_fn (nullptr if there is none) and the number of scopes walked up to find it.
+template<typename SymbolT, typename FindFn>
+std::pair<const SymbolT*, int> resolve_symbol(const std::deque<SymbolTable>& scopes,
+                                              const std::vector<ScopeId>& parent_scopes,
+                                              ScopeId scope,
+                                              FindFn&& find_fn) {
+  for (int depth = 0; scope != -1; depth++) {
+    const SymbolT* symbol = find_fn(scopes[scope]);
+    if (symbol != nullptr) {
+      return {symbol, depth};
+    }
+    scope = parent_scopes[scope];
+  }
+  return {nullptr, -1};
+}
+
+}
+
+namespace detail {
+
+// Number of entries of the table that are visible, all of them unless the state limits its scope.
+int num_visible_entries(const AnalysisState& state, const SymbolTable& symbol_table) {
+  for (const auto& visible_entries : state.visible_entries) {
+    if (visible_entries.scope == symbol_table.id()) {
+      return visible_entries.num_entries;
+    }
+  }
+  return symbol_table.num_entries();
+}
+
+// Finds the symbol in the table, among the entries that are visible. While a top level declaration is tracked, the
+// lookups in the program scope are recorded, and the procedures declared after the declaration are hidden.
+// Error for the symbols that were defined in the scope already, listed in the order of their declarations.
+SemanticAnalysisError already_defined_error(const std::vector<Identifier>& already_defined_symbols) {
+  std::string error = "[";
+  std::string sep;
+  for (Identifier s : already_defined_symbols) {
+    error += sep;
+    error += s.text();
+    sep = ", ";
+  }
+  error += "]";
+  return SemanticAnalysisError{fmt::format("Already defined symbols: {}", error)};
+}
+
+const Symbol* find_symbol(const AnalysisState& state, const SymbolTable& symbol_table, Identifier name) {
+  const Symbol* symbol = symbol_table.find(name, num_visible_entries(state, symbol_table));
+  DeclarationTracking* tracking = state.tracking;
+  if (tracking == nullptr || &symbol_table != tracking->program_scope) {
+    return symbol;
+  }
+  tracking->dependencies->program_scope_lookups.insert(name);
+  if (symbol != nullptr && std::holds_alternative<ProcedureHeaderSymbol>(*symbol)) {
+    auto index_it = tracking->procedure_indices->find(name);
+    if (index_it != tracking->procedure_indices->end() && index_it->second > tracking->declaration_index) {
+      return nullptr;
+    }
+  }
+  return symbol;
+}
+
+AstVisitorCallbacks make_analysis_callbacks(AnalysisState& state) {
+  auto& scopes = state.semantic_model.scopes;
+  auto& parent_scopes = state.semantic_model.parent_scopes;
+  auto& procedure_scopes = state.semantic_model.procedure_scopes;
+  auto& unanalysed_blocks = state.semantic_model.unanalysed_blocks;
+  auto& addresses = state.semantic_model.addresses;
+  auto& call_targets = state.semantic_model.call_targets;
+  auto& expression_types = state.semantic_model.expression_types;
+  auto& current_scope = state.current_scope;
+  auto& errors = state.errors;
+  auto& tracking = state.tracking;
 
   AstVisitorCallbacks callbacks{};
 
-  callbacks.program_pre = [&scopes, &current_scope](const Program& program) {
-    scopes[program.name] = SymbolTable{program.name};
-    current_scope = program.name;
+  callbacks.program_pre = [&scopes, &parent_scopes, &current_scope](const Program& program) {
+    assert(scopes.empty());
+    scopes.emplace_back(0, program.name);
+    parent_scopes.push_back(-1);
+    current_scope = 0;
   };
 
-  // TODO: Implement type checking.
-
   callbacks.procedure_decl_pre =
-      [&scopes, &current_scope, &parent_scopes, &errors](const ProcedureDecl& procedure_decl) {
-        auto insert = scopes.emplace(procedure_decl.name, SymbolTable{procedure_decl.name});
-        if (!insert.second) {
-          errors.push_back(SemanticAnalysisError{
-              fmt::format("Scope with name '{}' already exists.", procedure_decl.name)});
-          return;
+      [&state, &scopes, &current_scope, &parent_scopes, &procedure_scopes, &unanalysed_blocks, &errors, &tracking](
+          const ProcedureDecl& procedure_decl) {
+        // Every procedure gets its own scope, even if its header can't be defined, so that its body is analysed.
+        ScopeId scope = scopes.size();
+        auto& symbol_table = scopes.emplace_back(scope, procedure_decl.name);
+        parent_scopes.push_back(current_scope);
+        procedure_scopes[procedure_decl.id] = scope;
+        // Parameters are defined first, so that the header records the slots they are bound to.
+        std::vector<int> parameter_slots;
+        std::vector<Identifier> already_defined_parameters;
+        for (const auto& param : procedure_decl.parameters) {
+          if (symbol_table.define_parameter(param.identifier, value_type_of(param.type_specification))) {
+            parameter_slots.push_back(symbol_table.num_parameters() - 1);
+          } else {
+            parameter_slots.push_back(-1);
+            already_defined_parameters.push_back(param.identifier);
+          }
         }
         // Insert procedure in the current scope.
-        auto define_proc = scopes[*current_scope]
-            .define(procedure_decl.name,
-                    ProcedureHeaderSymbol{procedure_decl.name, procedure_decl.parameters, procedure_decl.block});
-        if (!define_proc) {
-          errors.push_back(SemanticAnalysisError{define_proc.error()});
+        ProcedureHeaderSymbol procedure_header{procedure_decl.name, procedure_decl.parameters,
+                                               std::move(parameter_slots), procedure_decl.block, &symbol_table};
+        bool is_tracked_declaration = tracking != nullptr && tracking->declaration == &procedure_decl;
+        if (is_tracked_declaration && tracking->replaces_header) {
+          scopes[current_scope].replace(procedure_decl.name, std::move(procedure_header));
+          tracking->dependencies->defines_header = true;
+        } else {
+          auto define_proc = scopes[current_scope].define(procedure_decl.name, std::move(procedure_header));
+          if (!define_proc) {
+            errors.push_back(SemanticAnalysisError{define_proc.error()});
+          }
+          if (is_tracked_declaration) {
+            tracking->dependencies->defines_header = define_proc.has_value();
+          }
         }
-        // Update parent and current scope.
-        parent_scopes[procedure_decl.name] = *current_scope;
-        current_scope = procedure_decl.name;
-
-        auto& symbol_table = insert.first->second;
-        for (const auto& param : procedure_decl.parameters) {
-          symbol_table.define(param.identifier, VariableSymbol{});
+        if (tracking != nullptr) {
+          tracking->dependencies->scopes.push_back(scope);
+        }
+        if (!already_defined_parameters.empty()) {
+          errors.push_back(detail::already_defined_error(already_defined_parameters));
+        }
+        current_scope = scope;
+        // The block is analysed by analyse_block() once it's parsed, with the symbols that are visible here.
+        if (procedure_decl.block->parsed() == nullptr) {
+          UnanalysedBlock unanalysed_block{scope, {}};
+          for (ScopeId enclosing = parent_scopes[scope]; enclosing != -1; enclosing = parent_scopes[enclosing]) {
+            unanalysed_block.enclosing_scopes.push_back(
+                VisibleEntries{enclosing, num_visible_entries(state, scopes[enclosing])});
+          }
+          unanalysed_blocks.emplace(procedure_decl.block, std::move(unanalysed_block));
         }
       };
 
-  callbacks.procedure_decl_post = [&current_scope, &parent_scopes](const ProcedureDecl& procedure_decl) {
-    current_scope = parent_scopes[*current_scope];
+  callbacks.procedure_decl_post = [&current_scope, &parent_scopes](const ProcedureDecl&) {
+    current_scope = parent_scopes[current_scope];
   };
 
   callbacks.procedure_call_post =
-      [&scopes, &current_scope, &parent_scopes, &errors](const ProcedureCall& procedure_call) {
+      [&state, &scopes, &current_scope, &parent_scopes, &addresses, &call_targets, &expression_types, &errors](
+          const ProcedureCall& procedure_call) {
         int num_passed_args = procedure_call.parameters.size();
 
-        // Lookup procedure symbol for each scope between this and root of the tree.
-        // TODO: Extract into helper method.
-        std::string tmp_scope = *current_scope;
-        std::optional<ProcedureHeaderSymbol> procedure_symbol{};
-        while (true) {
-          procedure_symbol = scopes[tmp_scope].find_procedure_header(procedure_call.name);
-          if (procedure_symbol) {
-            break;
-          }
-          auto parent_it = parent_scopes.find(tmp_scope);
-          if (parent_it == parent_scopes.end()) {
-            break;
-          }
-          tmp_scope = parent_it->second;
-        }
+        auto[procedure_symbol, depth] = detail::resolve_symbol<ProcedureHeaderSymbol>(
+            scopes, parent_scopes, current_scope, [&state, &procedure_call](const SymbolTable& symbol_table) {
+              return std::get_if<ProcedureHeaderSymbol>(find_symbol(state, symbol_table, procedure_call.name));
+            });
 
         // TODO: Ast nodes require metadata about the location in the text to provide better debug messages.
-        if (!procedure_symbol) {
+        if (procedure_symbol == nullptr) {
           errors.push_back(SemanticAnalysisError{fmt::format("Calling undefined procedure: {}", procedure_call.name)});
-        } else if (procedure_symbol->parameters.size() != num_passed_args) {
+          return;
+        }
+        if (static_cast<int>(procedure_symbol->parameters.size()) != num_passed_args) {
           errors.push_back(SemanticAnalysisError{fmt::format("Procedure '{}' expects {} arguments, but got {}",
                                                              procedure_call.name,
                                                              procedure_symbol->parameters.size(),
                                                              num_passed_args)});
+        } else {
+          for (int param_idx = 0; param_idx < num_passed_args; param_idx++) {
+            auto param_type = value_type_of(procedure_symbol->parameters[param_idx].type_specification);
+            auto argument_type = expression_types[node_id(procedure_call.parameters[param_idx])];
+            if (!is_assignable(param_type, argument_type)) {
+              errors.push_back(SemanticAnalysisError{
+                  fmt::format("Argument {} of procedure '{}' expects {}, but got {}",
+                              param_idx + 1, procedure_call.name, param_type, argument_type)});
+            }
+          }
         }
+        addresses[procedure_call.id] = LexicalAddress{depth, -1};
+        call_targets[procedure_call.id] = procedure_symbol;
       };
 
   callbacks.var_decl_pre = [&scopes, &current_scope, &errors](const VarDecl& var_decl) {
-    assert(current_scope.has_value());
-    auto scope_it = scopes.find(*current_scope);
-    assert(scope_it != scopes.end());
-    auto& symbol_table = scope_it->second;
+    assert(current_scope != -1);
+    auto& symbol_table = scopes[current_scope];
 
-    auto type_symbol = symbol_table.find(fmt::format("{}", var_decl.type_specification));
+    auto type_symbol = symbol_table.find(type_name(var_decl.type_specification));
     if (!type_symbol) {
       errors.push_back(SemanticAnalysisError{fmt::format("Unknown type symbol: '{}'", var_decl.type_specification)});
     }
@@ -101,39 +198,122 @@ Result<std::map<std::string, SymbolTable>,
       if (existing_symbol) {
         already_defined_symbols.push_back(variable_symbol.name);
       }
-      symbol_table.define(variable_symbol.name, VariableSymbol{});
+      symbol_table.define_variable(variable_symbol.name, value_type_of(var_decl.type_specification));
     }
     if (!already_defined_symbols.empty()) {
-      std::string error = "[";
-      std::string sep;
-      for (const auto& s : already_defined_symbols) {
-        error += sep + s;
-        sep = ", ";
-      }
-      error += "]";
-      errors.push_back(SemanticAnalysisError{fmt::format("Already defined symbols: {}", error)});
+      errors.push_back(detail::already_defined_error(already_defined_symbols));
     }
   };
 
-  callbacks.variable = [&scopes, &current_scope, &errors](const Variable& variable) {
-    assert(current_scope.has_value());
-    auto scope_it = scopes.find(*current_scope);
-    assert(scope_it != scopes.end());
-    auto& symbol_table = scope_it->second;
-
-    auto symbol = symbol_table.find(variable.name);
-    if (!symbol) {
+  callbacks.variable =
+      [&state, &scopes, &current_scope, &parent_scopes, &addresses, &expression_types, &errors](
+          const Variable& variable) {
+    assert(current_scope != -1);
+    auto[symbol, depth] = detail::resolve_symbol<Symbol>(
+        scopes, parent_scopes, current_scope, [&state, &variable](const SymbolTable& symbol_table) {
+          return find_symbol(state, symbol_table, variable.name);
+        });
+    if (symbol == nullptr) {
       errors.push_back(SemanticAnalysisError{fmt::format("Undefined symbol: {}", variable.name)});
+      return;
+    }
+    const auto* variable_symbol = std::get_if<VariableSymbol>(symbol);
+    if (variable_symbol == nullptr) {
+      errors.push_back(SemanticAnalysisError{fmt::format("Symbol '{}' is not a variable", variable.name)});
+      return;
+    }
+    addresses[variable.id] = LexicalAddress{depth, variable_symbol->slot};
+    expression_types[variable.id] = variable_symbol->type;
+  };
+
+  callbacks.num = [&expression_types](const Num& num) {
+    expression_types[num.id] = std::holds_alternative<int>(num.value) ? ValueType::INTEGER : ValueType::REAL;
+  };
+
+  callbacks.unary_op = [&expression_types](const UnaryOp& unary_op) {
+    expression_types[unary_op.id] = expression_types[node_id(*unary_op.node)];
+  };
+
+  callbacks.bin_op = [&expression_types, &errors](const BinOp& bin_op) {
+    auto left_type = expression_types[node_id(*bin_op.left)];
+    auto right_type = expression_types[node_id(*bin_op.right)];
+    switch (bin_op.op_type) {
+    case TokenType::INTEGER_DIV:
+      if (left_type != ValueType::INTEGER || right_type != ValueType::INTEGER) {
+        errors.push_back(SemanticAnalysisError{
+            fmt::format("Operator DIV expects INTEGER operands, but got {} and {}", left_type, right_type)});
+      }
+      expression_types[bin_op.id] = ValueType::INTEGER;
+      break;
+    case TokenType::REAL_DIV:
+      expression_types[bin_op.id] = ValueType::REAL;
+      break;
+    default:
+      expression_types[bin_op.id] = common_type(left_type, right_type);
+      break;
     }
   };
 
-  AstVisitorFn{callbacks}.visit(program);
+  callbacks.assignment_statement = [&expression_types, &errors](const AssignmentStatement& assignment_statement) {
+    const auto& variable = assignment_statement.variable;
+    auto variable_type = expression_types[variable.id];
+    auto expression_type = expression_types[node_id(assignment_statement.expression)];
+    if (!is_assignable(variable_type, expression_type)) {
+      errors.push_back(SemanticAnalysisError{
+          fmt::format("Cannot assign {} expression to {} variable '{}'", expression_type, variable_type,
+                      variable.name)});
+    }
+  };
+
+  return callbacks;
+}
+
+void reserve_node_ids(SemanticModel& semantic_model, NodeId max_node_id) {
+  if (static_cast<NodeId>(semantic_model.addresses.size()) > max_node_id) {
+    return;
+  }
+  semantic_model.addresses.resize(max_node_id + 1, LexicalAddress{-1, -1});
+  semantic_model.call_targets.resize(max_node_id + 1, nullptr);
+  // Expressions that reference undefined symbols are typed as INTEGER, which is promoted in any context,
+  // so that they don't produce any additional type errors.
+  semantic_model.expression_types.resize(max_node_id + 1, ValueType::INTEGER);
+  semantic_model.constant_values.resize(max_node_id + 1);
+}
+
+}
+
+Result<SemanticModel, std::vector<SemanticAnalysisError>> SemanticAnalyser::analyse(const Program& program) const {
+  SemanticModel semantic_model{};
+  // Program node is created last by the parser, so its id is the largest one, except for the lazily parsed blocks.
+  detail::reserve_node_ids(semantic_model, program.id);
+  // Current scope is first initialized in the program_pre callback.
+  // It is safe to assume it's always present while traversing AST.
+  detail::AnalysisState state{semantic_model, -1, {}};
+  AstVisitorFn{detail::make_analysis_callbacks(state)}.visit(program);
+
+  if (!state.errors.empty()) {
+    return make_error(std::move(state.errors));
+  }
+  return semantic_model;
+}
 
-  if (errors.empty()) {
-    return scopes;
-  } else {
-    return make_error(std::move(errors));
+Result<Void, std::vector<SemanticAnalysisError>> SemanticAnalyser::analyse_block(SemanticModel& semantic_model,
+                                                                                 const LazyBlock& lazy_block) const {
+  const Block* block = lazy_block.parsed();
+  auto unanalysed_it = semantic_model.unanalysed_blocks.find(&lazy_block);
+  assert(block != nullptr && unanalysed_it != semantic_model.unanalysed_blocks.end());
+  UnanalysedBlock unanalysed_block = std::move(unanalysed_it->second);
+  semantic_model.unanalysed_blocks.erase(unanalysed_it);
+  // Block node is created last by the parser, so its id is the largest one in the block.
+  detail::reserve_node_ids(semantic_model, block->id);
+  detail::AnalysisState state{semantic_model, unanalysed_block.scope, {}};
+  state.visible_entries = std::move(unanalysed_block.enclosing_scopes);
+  AstVisitorFn{detail::make_analysis_callbacks(state)}.visit(*block);
+
+  if (!state.errors.empty()) {
+    return make_error(std::move(state.errors));
   }
+  return {};
 }
 
-}
\ No newline at end of file
+}
@@ -5,7 +5,11 @@
 #ifndef PASCAL_COMPILER_TUTORIAL__SEMANTIC_ANALYSER_H
 #define PASCAL_COMPILER_TUTORIAL__SEMANTIC_ANALYSER_H
 
+#include <deque>
 #include <iostream>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include "ast_visitor.h"
 #include "symbol_table.h"
 
@@ -19,10 +23,110 @@ struct SemanticAnalysisError {
   }
 };
 
+// Static location of a variable, relative to the scope in which it is referenced.
+struct LexicalAddress {
+  // Number of enclosing scopes to walk up (following static links) to reach the scope that defines the symbol.
+  int depth;
+  // Slot of the variable in the stack frame of the defining scope. Unused for procedure calls.
+  int slot;
+};
+
+// Number of symbols of a scope that are visible to a block.
+struct VisibleEntries {
+  ScopeId scope;
+  int num_entries;
+};
+
+// Block of a procedure that wasn't parsed when the model was built.
+struct UnanalysedBlock {
+  // Scope of the procedure.
+  ScopeId scope;
+  // Entries of each enclosing scope, from the innermost one, that were defined at the point of the declaration. The
+  // symbols defined later are hidden from the block, so that its names resolve as if it was analysed in place.
+  std::vector<VisibleEntries> enclosing_scopes;
+};
+
+// Tables refer to the scopes by pointer, so the model can be moved, but not copied.
+struct SemanticModel {
+  // Indexed by ScopeId, the program scope is the first one. A deque, so that the pointers to the scopes remain valid
+  // as scopes are added.
+  std::deque<SymbolTable> scopes;
+  // Indexed by ScopeId. Enclosing scope of every scope, -1 for the program scope.
+  std::vector<ScopeId> parent_scopes;
+  // Scope of the body of every ProcedureDecl, keyed by its NodeId.
+  std::unordered_map<NodeId, ScopeId> procedure_scopes;
+  // Blocks of the procedures that weren't parsed when the model was built. Analysed by analyse_block().
+  std::unordered_map<const LazyBlock*, UnanalysedBlock> unanalysed_blocks;
+  // Indexed by NodeId, grows as lazily parsed blocks are analysed. Populated for every Variable and ProcedureCall node.
+  std::vector<LexicalAddress> addresses;
+  // Indexed by NodeId. Procedure called by each ProcedureCall node, nullptr for other nodes.
+  std::vector<const ProcedureHeaderSymbol*> call_targets;
+  // Indexed by NodeId. Static type of every ExpressionNode. INTEGER operands of REAL operations are promoted,
+  // so evaluation never has to inspect the runtime type of a value.
+  std::vector<ValueType> expression_types;
+  // Indexed by NodeId. Values of the expressions that the ConstantFolder evaluated at compile time, in their static
+  // types. Empty for the other nodes, including the Num nodes, which are constants anyway.
+  std::vector<std::optional<NumType>> constant_values;
+
+  SemanticModel() = default;
+  SemanticModel(SemanticModel&&) = default;
+  SemanticModel& operator=(SemanticModel&&) = default;
+  SemanticModel(const SemanticModel&) = delete;
+  SemanticModel& operator=(const SemanticModel&) = delete;
+};
+
+namespace detail {
+
+// What a top level declaration of the program depends on, recorded for the IncrementalSemanticAnalyser.
+struct DeclarationDependencies {
+  // Names that were looked up in the program scope, whether they were found or not.
+  std::unordered_set<Identifier> program_scope_lookups;
+  // Scopes created for the procedure and the nested ones.
+  std::vector<ScopeId> scopes;
+  // Whether the header of the procedure was defined in the program scope.
+  bool defines_header = false;
+};
+
+// Set while the IncrementalSemanticAnalyser analyses a top level declaration of the program.
+struct DeclarationTracking {
+  const SymbolTable* program_scope;
+  // Index of each top level procedure.
+  const std::unordered_map<Identifier, int>* procedure_indices;
+  // Procedures declared after the declaration aren't visible to it, as in a full analysis.
+  int declaration_index;
+  // Nullptr for the compound statement of the program.
+  const ProcedureDecl* declaration;
+  // Header of the declaration is kept in the program scope and is only replaced, so the pointers to it remain valid.
+  bool replaces_header;
+  DeclarationDependencies* dependencies;
+};
+
+// State of a single traversal, the results are stored in the model.
+struct AnalysisState {
+  SemanticModel& semantic_model;
+  // -1 until the program scope is created.
+  ScopeId current_scope;
+  std::vector<SemanticAnalysisError> errors;
+  DeclarationTracking* tracking = nullptr;
+  // Limits the symbols of the enclosing scopes while a lazily parsed block is analysed. Empty for a whole program.
+  std::vector<VisibleEntries> visible_entries{};
+};
+
+// Builds the callbacks that analyse the visited nodes into the state's model.
+AstVisitorCallbacks make_analysis_callbacks(AnalysisState& state);
+
+// Grows the tables that are indexed by NodeId, so that they cover the nodes up to the given id.
+void reserve_node_ids(SemanticModel& semantic_model, NodeId max_node_id);
+
+}
+
 class SemanticAnalyser {
 public:
-  Result<std::map<std::string, SymbolTable>, std::vector<SemanticAnalysisError>> analyse(const std::string& text,
-                                                                                         const Program& program) const;
+  Result<SemanticModel, std::vector<SemanticAnalysisError>> analyse(const Program& program) const;
+
+  // Analyses the block of the procedure after it was parsed lazily. The block must be in unanalysed_blocks.
+  Result<Void, std::vector<SemanticAnalysisError>> analyse_block(SemanticModel& semantic_model,
+                                                                 const LazyBlock& lazy_block) const;
 };
 
 }
@@ -0,0 +1,127 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fmt/format.h>
+#include "source_manager.h"
+#include "line_table.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PASCAL_COMPILER_TUTORIAL_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace freezing::interpreter {
+
+struct SourceManager::Source {
+  std::string name;
+  // Either the mapped file or the buffer, text views one of them.
+  void* mapping = nullptr;
+  std::size_t mapping_size = 0;
+  std::string buffer;
+  std::string_view text;
+  std::unique_ptr<LineTable> line_table;
+
+  Source() = default;
+  Source(const Source&) = delete;
+  Source& operator=(const Source&) = delete;
+
+  ~Source() {
+#ifdef PASCAL_COMPILER_TUTORIAL_HAS_MMAP
+    if (mapping != nullptr) {
+      munmap(mapping, mapping_size);
+    }
+#endif
+  }
+};
+
+#ifndef PASCAL_COMPILER_TUTORIAL_HAS_MMAP
+namespace detail {
+
+Result<std::string, SourceError> read_file(const std::string& path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    return make_error(SourceError{fmt::format("Cannot open file '{}'", path)});
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+}
+#endif
+
+SourceManager::SourceManager() = default;
+SourceManager::SourceManager(SourceManager&&) noexcept = default;
+SourceManager& SourceManager::operator=(SourceManager&&) noexcept = default;
+SourceManager::~SourceManager() = default;
+
+Result<SourceId, SourceError> SourceManager::load_file(const std::string& path) {
+  auto source = std::make_unique<Source>();
+  source->name = path;
+
+#ifdef PASCAL_COMPILER_TUTORIAL_HAS_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return make_error(SourceError{fmt::format("Cannot open file '{}': {}", path, std::strerror(errno))});
+  }
+  struct stat file_stat{};
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return make_error(SourceError{fmt::format("Cannot read file '{}': {}", path, std::strerror(errno))});
+  }
+  // Empty files can't be mapped, but there's nothing to map anyway.
+  if (file_stat.st_size > 0) {
+    void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      return make_error(SourceError{fmt::format("Cannot map file '{}': {}", path, std::strerror(errno))});
+    }
+    source->mapping = mapping;
+    source->mapping_size = file_stat.st_size;
+    source->text = std::string_view{static_cast<const char*>(mapping), source->mapping_size};
+  }
+  // The mapping remains valid after the file is closed.
+  close(fd);
+#else
+  auto text = detail::read_file(path);
+  if (!text) {
+    return forward_error(std::move(text));
+  }
+  source->buffer = std::move(*text);
+  source->text = source->buffer;
+#endif
+
+  sources_.push_back(std::move(source));
+  return static_cast<SourceId>(sources_.size() - 1);
+}
+
+SourceId SourceManager::add_buffer(std::string name, std::string&& text) {
+  auto source = std::make_unique<Source>();
+  source->name = std::move(name);
+  source->buffer = std::move(text);
+  source->text = source->buffer;
+  sources_.push_back(std::move(source));
+  return static_cast<SourceId>(sources_.size() - 1);
+}
+
+std::string_view SourceManager::text(SourceId source_id) const {
+  return sources_[source_id]->text;
+}
+
+const std::string& SourceManager::name(SourceId source_id) const {
+  return sources_[source_id]->name;
+}
+
+const LineTable& SourceManager::line_table(SourceId source_id) const {
+  Source& source = *sources_[source_id];
+  if (!source.line_table) {
+    source.line_table = std::make_unique<LineTable>(source.text);
+  }
+  return *source.line_table;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__SOURCE_MANAGER_H
+#define PASCAL_COMPILER_TUTORIAL__SOURCE_MANAGER_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "result.h"
+
+namespace freezing::interpreter {
+
+class LineTable;
+
+// Handle to a source owned by the SourceManager.
+using SourceId = int;
+
+struct SourceError {
+  std::string message;
+
+  friend std::ostream& operator<<(std::ostream& os, const SourceError& e) {
+    return os << "SourceError: " << e.message;
+  }
+};
+
+// Owns the text of all sources, so the rest of the pipeline only passes around views into it and never copies it.
+// Texts never move, so views remain valid for as long as the manager exists, even if more sources are added.
+class SourceManager {
+public:
+  SourceManager();
+  SourceManager(const SourceManager&) = delete;
+  SourceManager& operator=(const SourceManager&) = delete;
+  SourceManager(SourceManager&&) noexcept;
+  SourceManager& operator=(SourceManager&&) noexcept;
+  ~SourceManager();
+
+  // Maps the file into memory, where supported, otherwise reads it once.
+  Result<SourceId, SourceError> load_file(const std::string& path);
+  // Takes over the text that is already in memory.
+  SourceId add_buffer(std::string name, std::string&& text);
+
+  std::string_view text(SourceId source_id) const;
+  // Path of the file, or the name given to the buffer.
+  const std::string& name(SourceId source_id) const;
+  // Built on the first use, which makes it unsafe to call concurrently for the same source.
+  const LineTable& line_table(SourceId source_id) const;
+
+private:
+  struct Source;
+
+  std::vector<std::unique_ptr<Source>> sources_;
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__SOURCE_MANAGER_H
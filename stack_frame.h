@@ -6,19 +6,30 @@
 #define PASCAL_COMPILER_TUTORIAL__STACK_FRAME_H
 
 #include <iostream>
+#include <optional>
 #include <fmt/format.h>
 #include "memory.h"
+#include "symbol_table.h"
 
 namespace freezing::interpreter {
 
+// Frame of an active procedure call. The slots are owned by the CallStack.
 struct StackFrame {
-  std::string scope_name;
-  std::map<std::string, DataType> variables;
+  const SymbolTable* scope;
+  // Index of the frame of the lexically enclosing scope in the call stack. -1 for the main program.
+  int static_link;
+  // Index of the first slot of the frame in the call stack slot region.
+  int base;
+  // Points to the slot region at base. Indexed by the slots assigned by SemanticAnalyser.
+  // Empty optional means uninitialized variable.
+  std::optional<DataType>* slots;
 
   friend std::ostream& operator<<(std::ostream& os, const StackFrame& frame) {
-    os << fmt::format("StackFrame({})", frame.scope_name) << std::endl;
-    for (const auto& variable : frame.variables) {
-      os << "  " << variable.first << " = " << variable.second << std::endl;
+    os << fmt::format("StackFrame({})", frame.scope->name()) << std::endl;
+    for (int slot = 0; slot < frame.scope->num_slots(); slot++) {
+      if (frame.slots[slot]) {
+        os << "  " << frame.scope->slot_names()[slot] << " = " << *frame.slots[slot] << std::endl;
+      }
     }
     return os;
   }
@@ -2,64 +2,172 @@
 // Created by nikola on 3/20/2021.
 //
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <iomanip>
 #include <fmt/format.h>
 #include "token.h"
 #include "symbol_table.h"
-#include "variant_match.h"
 
 namespace freezing::interpreter {
 
-SymbolTable::SymbolTable(const std::string& name) : name_{name} {
-  initialize();
+Identifier type_name(TokenType type_specification) {
+  // Interned once, rather than formatted for every scope.
+  static const Identifier integer_name{fmt::format("{}", TokenType::INTEGER)};
+  static const Identifier real_name{fmt::format("{}", TokenType::REAL)};
+  assert(type_specification == TokenType::INTEGER || type_specification == TokenType::REAL);
+  return type_specification == TokenType::INTEGER ? integer_name : real_name;
 }
 
-SymbolTable::SymbolTable(std::string&& name) : name_{std::move(name)} {
+SymbolTable::SymbolTable(ScopeId id, Identifier name) : id_{id}, name_{name} {
   initialize();
 }
 
 void SymbolTable::initialize() {
-  symbols_[fmt::format("{}", TokenType::INTEGER)] = TypeSpecificationSymbol{};
-  symbols_[fmt::format("{}", TokenType::REAL)] = TypeSpecificationSymbol{};
+  define(type_name(TokenType::INTEGER), TypeSpecificationSymbol{});
+  define(type_name(TokenType::REAL), TypeSpecificationSymbol{});
 }
 
-Result<Void> SymbolTable::define(const std::string& symbol_name, Symbol&& symbol) {
-  auto pair = symbols_.insert({symbol_name, std::move(symbol)});
-  if (!pair.second) {
+Result<Void> SymbolTable::define(Identifier symbol_name, Symbol&& symbol) {
+  if (2 * (entries_.size() + 1) > index_.size()) {
+    grow_index();
+  }
+  size_t slot = find_slot(symbol_name);
+  if (index_[slot].entry != -1) {
     return make_error(fmt::format("Symbol '{}' is already defined.", symbol_name));
   }
+  index_[slot] = IndexSlot{symbol_name.id(), static_cast<int>(entries_.size())};
+  entries_.push_back(Entry{symbol_name, std::move(symbol), false});
   return {};
 }
 
-std::optional<Symbol> SymbolTable::find(const std::string& symbol_name) const {
-  auto it = symbols_.find(symbol_name);
-  if (it == symbols_.end()) {
-    return {};
+void SymbolTable::replace(Identifier symbol_name, Symbol&& symbol) {
+  size_t slot = find_slot(symbol_name);
+  assert(index_[slot].entry != -1);
+  entries_[index_[slot].entry].symbol = std::move(symbol);
+}
+
+void SymbolTable::erase(Identifier symbol_name) {
+  size_t hole = find_slot(symbol_name);
+  assert(index_[hole].entry != -1 && !std::holds_alternative<VariableSymbol>(entries_[index_[hole].entry].symbol));
+  // Entry stays in place, since the pointers to the other symbols must remain valid.
+  entries_[index_[hole].entry].is_erased = true;
+  // Shifts back the slots that follow the erased one, unless that would move them before their home slot, so that the
+  // probe sequences stay unbroken without tombstones.
+  size_t mask = index_.size() - 1;
+  for (size_t next = (hole + 1) & mask; index_[next].entry != -1; next = (next + 1) & mask) {
+    size_t home = index_[next].name_id & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      index_[hole] = index_[next];
+      hole = next;
+    }
+  }
+  index_[hole].entry = -1;
+}
+
+Result<Void> SymbolTable::define_variable(Identifier variable_name, ValueType type) {
+  auto result = define(variable_name, VariableSymbol{num_slots(), type});
+  if (result) {
+    slot_names_.push_back(variable_name);
+  }
+  return result;
+}
+
+Result<Void> SymbolTable::define_parameter(Identifier parameter_name, ValueType type) {
+  assert(num_slots() == num_parameters_ && "Parameters are defined before the other variables.");
+  auto result = define_variable(parameter_name, type);
+  if (result) {
+    num_parameters_++;
+  }
+  return result;
+}
+
+const Symbol* SymbolTable::find(Identifier symbol_name) const {
+  if (index_.empty()) {
+    return nullptr;
+  }
+  const IndexSlot& slot = index_[find_slot(symbol_name)];
+  if (slot.entry == -1) {
+    return nullptr;
+  }
+  return &entries_[slot.entry].symbol;
+}
+
+const Symbol* SymbolTable::find(Identifier symbol_name, int num_visible_entries) const {
+  if (index_.empty()) {
+    return nullptr;
   }
-  return it->second;
+  const IndexSlot& slot = index_[find_slot(symbol_name)];
+  if (slot.entry == -1 || slot.entry >= num_visible_entries) {
+    return nullptr;
+  }
+  return &entries_[slot.entry].symbol;
+}
+
+int SymbolTable::num_entries() const {
+  return entries_.size();
 }
 
-const std::map<std::string, Symbol>& SymbolTable::data() const {
-  return symbols_;
+ScopeId SymbolTable::id() const {
+  return id_;
 }
 
-const std::string& SymbolTable::name() const {
+Identifier SymbolTable::name() const {
   return name_;
 }
-std::optional<ProcedureHeaderSymbol> SymbolTable::find_procedure_header(const std::string& procedure_name) const {
-  auto symbol = find(procedure_name);
-  if (!symbol) {
-    return {};
+
+int SymbolTable::num_slots() const {
+  return slot_names_.size();
+}
+
+int SymbolTable::num_parameters() const {
+  return num_parameters_;
+}
+
+const std::vector<Identifier>& SymbolTable::slot_names() const {
+  return slot_names_;
+}
+
+const ProcedureHeaderSymbol* SymbolTable::find_procedure_header(Identifier procedure_name) const {
+  const Symbol* symbol = find(procedure_name);
+  if (symbol == nullptr) {
+    return nullptr;
+  }
+  return std::get_if<ProcedureHeaderSymbol>(symbol);
+}
+
+size_t SymbolTable::find_slot(Identifier symbol_name) const {
+  size_t mask = index_.size() - 1;
+  for (size_t slot = symbol_name.id() & mask;; slot = (slot + 1) & mask) {
+    const IndexSlot& index_slot = index_[slot];
+    if (index_slot.entry == -1 || index_slot.name_id == symbol_name.id()) {
+      return slot;
+    }
   }
-  return variant_try_get<ProcedureHeaderSymbol>(*symbol);
+}
+
+void SymbolTable::grow_index() {
+  std::vector<IndexSlot> index(std::max<size_t>(8, 2 * index_.size()), IndexSlot{0, -1});
+  size_t mask = index.size() - 1;
+  for (const auto& index_slot : index_) {
+    if (index_slot.entry == -1) {
+      continue;
+    }
+    size_t slot = index_slot.name_id & mask;
+    while (index[slot].entry != -1) {
+      slot = (slot + 1) & mask;
+    }
+    index[slot] = index_slot;
+  }
+  index_ = std::move(index);
 }
 
 std::ostream& operator<<(std::ostream& os, const VariableSymbol& symbol) {
-  return os << "VariableSymbol";
+  return os << fmt::format("VariableSymbol(slot={}, type={})", symbol.slot, symbol.type);
 }
 
-std::ostream& operator<<(std::ostream& os, const TypeSpecificationSymbol& symbol) {
+std::ostream& operator<<(std::ostream& os, const TypeSpecificationSymbol&) {
   return os << "TypeSpecificationSymbol";
 }
 
@@ -73,9 +181,9 @@ std::ostream& operator<<(std::ostream& os, const Symbol& symbol) {
 
 std::ostream& operator<<(std::ostream& os, const SymbolTable& symbol_table) {
   os << "SymbolTable(" << symbol_table.name() << ")" << std::endl;
-  for (const auto &[key, value] : symbol_table.data()) {
-    os << std::setw(10) << key << " -> " << value << std::endl;
-  }
+  symbol_table.for_each([&os](Identifier name, const Symbol& symbol) {
+    os << std::setw(10) << name << " -> " << symbol << std::endl;
+  });
   return os;
 }
 
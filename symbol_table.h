@@ -8,46 +8,128 @@
 #include <variant>
 #include <ostream>
 #include <optional>
-#include <map>
-#include <string>
+#include <cstdint>
+#include <deque>
 #include <fmt/format.h>
 #include "result.h"
 #include "ast.h"
+#include "identifier.h"
+#include "value_type.h"
 
 namespace freezing::interpreter {
 
-struct VariableSymbol {};
+class SymbolTable;
+
+// Dense index of a scope in the SemanticModel. The program scope is the first one.
+using ScopeId = int;
+
+struct VariableSymbol {
+  // Index of the variable in the stack frame of the scope that defines it.
+  int slot;
+  ValueType type;
+};
 struct TypeSpecificationSymbol {};
 struct ProcedureHeaderSymbol {
-  std::string name;
+  Identifier name;
   std::vector<Param> parameters;
-  std::shared_ptr<Block> block;
+  // Slot of each parameter in the scope of the body, -1 for a parameter that repeats the name of an earlier one and
+  // isn't bound to the argument.
+  std::vector<int> parameter_slots;
+  // Points into the arena of the Program, so it's valid only for as long as the Program exists.
+  const LazyBlock* block;
+  // Scope of the procedure body.
+  const SymbolTable* scope;
 };
 using Symbol = std::variant<VariableSymbol, TypeSpecificationSymbol, ProcedureHeaderSymbol>;
 
 class SymbolTable {
 public:
   SymbolTable() = default;
-  SymbolTable(const std::string& name);
-  SymbolTable(std::string&& name);
+  SymbolTable(ScopeId id, Identifier name);
+
+  Result<Void> define(Identifier symbol_name, Symbol&& symbol);
+
+  // Replaces the symbol that is already defined with the name. Pointers to the symbol remain valid.
+  void replace(Identifier symbol_name, Symbol&& symbol);
+
+  // Removes the symbol. Variables can't be removed, since they own slots.
+  void erase(Identifier symbol_name);
+
+  // Defines a variable symbol and assigns it the next free slot.
+  Result<Void> define_variable(Identifier variable_name, ValueType type);
 
-  Result<Void> define(const std::string& symbol_name, Symbol&& symbol);
+  // Defines a variable symbol for a formal parameter. Parameters are defined before any other variable, so they
+  // occupy the first slots.
+  Result<Void> define_parameter(Identifier parameter_name, ValueType type);
 
-  std::optional<Symbol> find(const std::string& symbol_name) const;
+  // Lookups return pointers into the table, which remain valid for as long as the table exists, even if it's moved.
+  // Nullptr is returned if the symbol isn't found.
+  const Symbol* find(Identifier symbol_name) const;
 
-  std::optional<ProcedureHeaderSymbol> find_procedure_header(const std::string& procedure_name) const;
+  // Finds the symbol only if it's one of the first num_visible_entries that were defined, i.e. if it was defined when
+  // the table had that many entries.
+  const Symbol* find(Identifier symbol_name, int num_visible_entries) const;
 
-  const std::map<std::string, Symbol>& data() const;
+  const ProcedureHeaderSymbol* find_procedure_header(Identifier procedure_name) const;
 
-  const std::string& name() const;
+  // Calls fn(name, symbol) for each symbol, in the order in which they were defined.
+  template<typename Fn>
+  void for_each(Fn&& fn) const {
+    for (const auto& entry : entries_) {
+      if (!entry.is_erased) {
+        fn(entry.name, entry.symbol);
+      }
+    }
+  }
+
+  // Number of symbols defined so far, including the erased ones.
+  int num_entries() const;
+
+  ScopeId id() const;
+
+  Identifier name() const;
+
+  // Number of slots required by the stack frame of this scope.
+  int num_slots() const;
+
+  // Number of slots occupied by the parameters.
+  int num_parameters() const;
+
+  // Names of the variables, indexed by slot.
+  const std::vector<Identifier>& slot_names() const;
 
 private:
-  std::string name_;
-  std::map<std::string, Symbol> symbols_;
+  struct Entry {
+    Identifier name;
+    Symbol symbol;
+    bool is_erased;
+  };
+  // Slot of the open addressing index. The id of the name is kept in the slot, so that a probe never touches the
+  // entries. Ids are dense, so they are used as their own hashes.
+  struct IndexSlot {
+    uint32_t name_id;
+    // -1 for an empty slot.
+    int entry;
+  };
+
+  ScopeId id_ = -1;
+  Identifier name_;
+  // In the order of definition. A deque, so that the pointers to the symbols remain valid as the table grows.
+  std::deque<Entry> entries_;
+  // Linear probing over the entries, its size is a power of two and at least twice the number of entries.
+  std::vector<IndexSlot> index_;
+  std::vector<Identifier> slot_names_;
+  int num_parameters_ = 0;
 
   void initialize();
+  // Returns the index slot that holds the symbol, or the empty slot where it would be inserted.
+  size_t find_slot(Identifier symbol_name) const;
+  void grow_index();
 };
 
+// Name of the type symbol that every scope defines for the type specification, which is either INTEGER or REAL.
+Identifier type_name(TokenType type_specification);
+
 std::ostream& operator<<(std::ostream& os, const VariableSymbol& symbol);
 std::ostream& operator<<(std::ostream& os, const TypeSpecificationSymbol& symbol);
 std::ostream& operator<<(std::ostream& os, const ProcedureHeaderSymbol& symbol);
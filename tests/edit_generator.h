@@ -0,0 +1,82 @@
+#ifndef PASCAL_COMPILER_TUTORIAL_TESTS__EDIT_GENERATOR_H
+#define PASCAL_COMPILER_TUTORIAL_TESTS__EDIT_GENERATOR_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "incremental_parser.h"
+#include "token.h"
+
+namespace freezing::interpreter::test {
+
+// Generates random edits of a source around its tokens, the way a user would type them: renaming identifiers, adding
+// statements and parameters, changing types, and adding spaces, lines and comments. Some of the edits break the
+// program, and the later ones may fix it again. The same seed generates the same edits for the same texts.
+class EditGenerator {
+public:
+  explicit EditGenerator(uint32_t seed) : rng_{seed} {}
+
+  TextEdit generate(std::string_view text, const std::vector<Token>& tokens) {
+    static const char* kNames[] = {"P0", "P1", "P2", "P1N0", "a", "b", "r", "x", "y", "t", "Q"};
+    static const char* kStatements[] = {" P0(1, 2);", "\n  P1(x, y);", " x := y;", "\n  r := a / 2;", " Q(1, 2);"};
+    static const char* kParameters[] = {"; z : REAL", "; w : INTEGER"};
+
+    if (tokens.empty()) {
+      // Text can't be lexed, so the edit goes anywhere.
+      return TextEdit{random(text.size() + 1), 0, " "};
+    }
+    const Token& token = tokens[random(tokens.size())];
+    int begin = token.offset;
+    int end = token.offset + token.length;
+    switch (random(8)) {
+      case 0:
+      case 1:
+        if (token.token_type == TokenType::ID) {
+          return TextEdit{begin, static_cast<int>(token.length), kNames[random(std::size(kNames))]};
+        }
+        break;
+      case 2:
+        if (token.token_type == TokenType::SEMICOLON) {
+          return TextEdit{end, 0, kStatements[random(std::size(kStatements))]};
+        }
+        break;
+      case 3:
+        if (token.token_type == TokenType::INTEGER || token.token_type == TokenType::REAL) {
+          const char* type = token.token_type == TokenType::INTEGER ? "REAL" : "INTEGER";
+          return random(2) == 0 ? TextEdit{begin, static_cast<int>(token.length), type}
+                                : TextEdit{end, 0, kParameters[random(std::size(kParameters))]};
+        }
+        break;
+      case 4:
+        return TextEdit{begin, 0, random(2) == 0 ? "{ comment }" : "{ comment\n  on two lines }\n"};
+      case 5:
+        // Removes the token, which mostly breaks the program.
+        if (random(4) == 0) {
+          return TextEdit{begin, static_cast<int>(token.length), ""};
+        }
+        break;
+      default:
+        break;
+    }
+    return TextEdit{begin, 0, " "};
+  }
+
+private:
+  std::mt19937 rng_;
+
+  int random(size_t bound) {
+    return static_cast<int>(rng_() % bound);
+  }
+};
+
+// Edit that undoes the edit that was applied to the text.
+inline TextEdit undo_edit(std::string_view text_before, const TextEdit& edit) {
+  return TextEdit{edit.offset, static_cast<int>(edit.inserted_text.size()),
+                  std::string{text_before.substr(edit.offset, edit.removed_length)}};
+}
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL_TESTS__EDIT_GENERATOR_H
@@ -0,0 +1,175 @@
+// Checks that the FlatAst holds the same nodes as the Program it was created from, and that FlatAstVisitorFn visits
+// them in the same order as AstVisitorFn, also when only some of the blocks were parsed.
+
+#include <sstream>
+#include <string>
+#include "ast_visitor.h"
+#include "flat_ast.h"
+#include "parser.h"
+#include "program_generator.h"
+#include "source_manager.h"
+#include "test_utils.h"
+
+namespace freezing::interpreter::test {
+
+namespace {
+
+// Id, label and the ids of the children of every node, in the order of the visit.
+std::string describe(const Program& program) {
+  std::stringstream nodes{};
+  auto describe_node = [&nodes](NodeId node_id, const auto& label, std::initializer_list<NodeId> children) {
+    nodes << node_id << ":" << label << "[";
+    for (NodeId child_id : children) {
+      nodes << child_id << " ";
+    }
+    nodes << "] ";
+  };
+  AstVisitorCallbacks callbacks{};
+  callbacks.program_post = [&describe_node](const Program& program) {
+    describe_node(program.id, program.name, {program.block.id});
+  };
+  callbacks.block = [&nodes](const Block& block) {
+    nodes << block.id << ":Block[";
+    for (const auto& var_decl : block.variable_declarations) {
+      nodes << var_decl.id << " ";
+    }
+    for (const auto& procedure_decl : block.procedure_declarations) {
+      nodes << procedure_decl.id << " ";
+    }
+    nodes << block.compound_statement.id << " ] ";
+  };
+  callbacks.var_decl_post = [&nodes](const VarDecl& var_decl) {
+    nodes << var_decl.id << ":" << var_decl.type_specification << "[";
+    for (const auto& variable : var_decl.variables) {
+      nodes << variable.id << " ";
+    }
+    nodes << "] ";
+  };
+  callbacks.procedure_decl_post = [&nodes](const ProcedureDecl& procedure_decl) {
+    nodes << procedure_decl.id << ":" << procedure_decl.name << "[";
+    for (const auto& param : procedure_decl.parameters) {
+      nodes << param.id << " ";
+    }
+    if (const Block* block = procedure_decl.block->parsed()) {
+      nodes << block->id << " ";
+    }
+    nodes << "] ";
+  };
+  callbacks.param = [&nodes](const Param& param) {
+    nodes << param.id << ":" << param.identifier << ":" << param.type_specification << "[] ";
+  };
+  callbacks.compound_statement = [&nodes](const CompoundStatement& compound_statement) {
+    nodes << compound_statement.id << ":Compound[";
+    for (const auto& statement : compound_statement.statements) {
+      nodes << node_id(statement) << " ";
+    }
+    nodes << "] ";
+  };
+  callbacks.assignment_statement = [&describe_node](const AssignmentStatement& assignment_statement) {
+    describe_node(assignment_statement.id, ":=",
+                  {assignment_statement.variable.id, node_id(assignment_statement.expression)});
+  };
+  callbacks.procedure_call_post = [&nodes](const ProcedureCall& procedure_call) {
+    nodes << procedure_call.id << ":" << procedure_call.name << "()[";
+    for (const auto& argument : procedure_call.parameters) {
+      nodes << node_id(argument) << " ";
+    }
+    nodes << "] ";
+  };
+  callbacks.unary_op = [&describe_node](const UnaryOp& unary_op) {
+    describe_node(unary_op.id, unary_op.op_type, {node_id(*unary_op.node)});
+  };
+  callbacks.bin_op = [&describe_node](const BinOp& bin_op) {
+    describe_node(bin_op.id, bin_op.op_type, {node_id(*bin_op.left), node_id(*bin_op.right)});
+  };
+  callbacks.variable = [&describe_node](const Variable& variable) {
+    describe_node(variable.id, variable.name, {});
+  };
+  callbacks.num = [&describe_node](const Num& num) {
+    describe_node(num.id, fmt::format("{}", num.value), {});
+  };
+  callbacks.empty = [&describe_node](const Empty& empty) {
+    describe_node(empty.id, "Empty", {});
+  };
+  AstVisitorFn{callbacks}.visit(program);
+  return nodes.str();
+}
+
+// Same as describe(), but from the FlatAst.
+std::string describe(const FlatAst& ast) {
+  std::stringstream nodes{};
+  auto describe_node = [&nodes, &ast](NodeId node_id, const auto& label) {
+    nodes << node_id << ":" << label << "[";
+    for (auto it = ast.children_begin(node_id); it != ast.children_end(node_id); ++it) {
+      nodes << *it << " ";
+    }
+    nodes << "] ";
+  };
+  auto describe_named = [&ast, &describe_node](NodeId node_id) { describe_node(node_id, ast.name(node_id)); };
+  auto describe_typed = [&ast, &describe_node](NodeId node_id) { describe_node(node_id, ast.token_type(node_id)); };
+  FlatAstVisitorCallbacks callbacks{};
+  callbacks.program_post = describe_named;
+  callbacks.block = [&describe_node](NodeId node_id) { describe_node(node_id, "Block"); };
+  callbacks.var_decl_post = describe_typed;
+  callbacks.procedure_decl_post = describe_named;
+  callbacks.param = [&ast, &describe_node](NodeId node_id) {
+    describe_node(node_id, fmt::format("{}:{}", ast.name(node_id), ast.token_type(node_id)));
+  };
+  callbacks.compound_statement = [&describe_node](NodeId node_id) { describe_node(node_id, "Compound"); };
+  callbacks.assignment_statement = [&describe_node](NodeId node_id) { describe_node(node_id, ":="); };
+  callbacks.procedure_call_post = [&ast, &describe_node](NodeId node_id) {
+    describe_node(node_id, fmt::format("{}()", ast.name(node_id)));
+  };
+  callbacks.unary_op = describe_typed;
+  callbacks.bin_op = describe_typed;
+  callbacks.variable = describe_named;
+  callbacks.num = [&ast, &describe_node](NodeId node_id) {
+    describe_node(node_id, fmt::format("{}", ast.value(node_id)));
+  };
+  callbacks.empty = [&describe_node](NodeId node_id) { describe_node(node_id, "Empty"); };
+  FlatAstVisitorFn{callbacks}.visit(ast);
+  return nodes.str();
+}
+
+// Parses every other procedure body of a lazily parsed program, so that the FlatAst has both parsed blocks, whose ids
+// are larger than the id of the program, and unparsed ones.
+void parse_every_other_block(const std::vector<ProcedureDecl>& procedure_declarations) {
+  for (size_t i = 0; i < procedure_declarations.size(); i += 2) {
+    auto block = procedure_declarations[i].block->get();
+    if (block) {
+      parse_every_other_block((*block)->procedure_declarations);
+    }
+  }
+}
+
+void expect_same_nodes(const std::string& text, bool lazy_procedure_bodies, const std::string& context) {
+  SourceManager source_manager{};
+  SourceId source_id = source_manager.add_buffer("generated.pas", std::string{text});
+  ParserOptions options{};
+  options.lazy_procedure_bodies = lazy_procedure_bodies;
+  auto parser = Parser::create(source_manager, source_id, options);
+  if (!expect(parser.has_value(), "lexer fails", context)) {
+    return;
+  }
+  auto program = parser->parse_program();
+  if (!expect(program.has_value(), "program doesn't parse", context)) {
+    return;
+  }
+  parse_every_other_block(program->block.procedure_declarations);
+  expect_eq(describe(FlatAst::create(*program)), describe(*program), "nodes", context);
+}
+
+}
+
+}
+
+int main() {
+  using namespace freezing::interpreter::test;
+
+  for (uint32_t seed = 0; seed < 100; seed++) {
+    std::string text = ProgramGenerator{seed}.generate(1 + seed % 8);
+    expect_same_nodes(text, false, fmt::format("seed {}", seed));
+    expect_same_nodes(text, true, fmt::format("seed {}, lazy", seed));
+  }
+  return test_result();
+}
@@ -0,0 +1,205 @@
+// Checks that the IncrementalParser keeps the tokens and the program the same as lexing and parsing the edited text from
+// scratch, after each edit of a sequence.
+
+#include <cctype>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast_dot_visualiser.h"
+#include "edit_generator.h"
+#include "incremental_parser.h"
+#include "lexer.h"
+#include "parser.h"
+#include "program_generator.h"
+#include "source_manager.h"
+#include "test_utils.h"
+
+namespace freezing::interpreter::test {
+
+namespace {
+
+constexpr int kNumEdits = 200;
+// Every so many edits, the text is replaced with the original one, which is parsed from scratch.
+constexpr int kResetInterval = 50;
+
+std::string describe_error(const ParserErrorsT& error) {
+  return std::visit([](const auto& e) {
+    return fmt::format("{} at offset {}", e.diagnostic.message(), e.diagnostic.offset);
+  }, error);
+}
+
+// Re-parsed declarations get new node ids, so the ids are renumbered in the order in which they first appear in the
+// graph, which only depends on the structure of the program.
+std::string renumber_nodes(const std::string& dot) {
+  std::unordered_map<std::string_view, int> numbers;
+  std::string renumbered{};
+  size_t copied = 0;
+  for (size_t pos = dot.find("node"); pos != std::string::npos; pos = dot.find("node", copied)) {
+    size_t id_begin = pos + 4;
+    size_t id_end = id_begin;
+    while (id_end < dot.size() && std::isdigit(static_cast<unsigned char>(dot[id_end]))) {
+      id_end++;
+    }
+    renumbered.append(dot, copied, id_begin - copied);
+    if (id_end > id_begin) {
+      std::string_view id{dot.data() + id_begin, id_end - id_begin};
+      renumbered += std::to_string(numbers.emplace(id, numbers.size()).first->second);
+    }
+    copied = id_end;
+  }
+  renumbered.append(dot, copied);
+  return renumbered;
+}
+
+// Graph of the program, or the error.
+std::string describe_program(const Result<const Program*, ParserErrorsT>& program) {
+  if (!program) {
+    return describe_error(program.error());
+  }
+  return renumber_nodes(AstDotVisualiser{}.generate(**program));
+}
+
+std::string parse_from_scratch(std::string_view text) {
+  SourceManager source_manager{};
+  SourceId source_id = source_manager.add_buffer("edited.pas", std::string{text});
+  auto parser = Parser::create(source_manager, source_id);
+  if (!parser) {
+    return describe_error(parser.error());
+  }
+  auto program = parser->parse_program();
+  if (!program) {
+    return describe_error(parser->error(program.error()));
+  }
+  return renumber_nodes(AstDotVisualiser{}.generate(*program));
+}
+
+void expect_same_as_from_scratch(const IncrementalParser& incremental_parser,
+                                 const Result<const Program*, ParserErrorsT>& program,
+                                 const std::string& context) {
+  auto tokens = Lexer{incremental_parser.text(), 0}.lex_all();
+  expect_same_tokens(incremental_parser.tokens(), tokens ? *tokens : std::vector<Token>{}, context);
+  expect_eq(describe_program(program), parse_from_scratch(incremental_parser.text()), "program", context);
+}
+
+void run_edits(uint32_t seed) {
+  std::string original = ProgramGenerator{seed}.generate(3 + seed % 6);
+  IncrementalParser incremental_parser{0, original};
+  auto program = incremental_parser.parse();
+  expect_same_as_from_scratch(incremental_parser, program, fmt::format("seed {}, initial parse", seed));
+
+  EditGenerator edit_generator{seed};
+  int num_procedure_changes = 0;
+  for (int step = 1; step <= kNumEdits; step++) {
+    TextEdit edit = step % kResetInterval == 0
+                    ? TextEdit{0, static_cast<int>(incremental_parser.text().size()), original}
+                    : edit_generator.generate(incremental_parser.text(), incremental_parser.tokens());
+    program = incremental_parser.apply(edit);
+    if (incremental_parser.last_change() == ProgramChange::PROCEDURE) {
+      num_procedure_changes++;
+    }
+    std::string context = fmt::format("seed {}, edit {}: {} characters at {} replaced with '{}'", seed, step,
+                                      edit.removed_length, edit.offset, edit.inserted_text);
+    expect_same_as_from_scratch(incremental_parser, program, context);
+  }
+  // Otherwise the test would only check the parser that parses from scratch.
+  expect(num_procedure_changes > 0, "no procedure was re-parsed on its own", fmt::format("seed {}", seed));
+}
+
+// Adds a statement to each top level procedure in turn, which must only re-parse that procedure, however the earlier
+// edits moved its tokens and lines.
+void edit_each_procedure(uint32_t seed) {
+  IncrementalParser incremental_parser{0, ProgramGenerator{seed}.generate(3 + seed % 6)};
+  auto program = incremental_parser.parse();
+  expect_same_as_from_scratch(incremental_parser, program, fmt::format("seed {}, initial parse", seed));
+
+  for (size_t pos = incremental_parser.text().find("\nPROCEDURE"); pos != std::string::npos;
+       pos = incremental_parser.text().find("\nPROCEDURE", pos + 1)) {
+    // The first block in the declaration is either its own or the one of a nested procedure.
+    size_t block_begin = incremental_parser.text().find("BEGIN\n", pos) + 5;
+    TextEdit edit{static_cast<int>(block_begin), 0, "\n  x := y;\n  r := a / 2;"};
+    program = incremental_parser.apply(edit);
+    std::string context = fmt::format("seed {}, statements added at {}", seed, block_begin);
+    expect(incremental_parser.last_change() == ProgramChange::PROCEDURE, "the procedure wasn't re-parsed on its own",
+           context);
+    expect_same_as_from_scratch(incremental_parser, program, context);
+  }
+}
+
+// Applies the edit to the text and then undoes it, and expects the edit to change the program as given.
+void apply_and_undo(const std::string& text, const TextEdit& edit, ProgramChange expected_change,
+                    const std::string& context) {
+  IncrementalParser incremental_parser{0, text};
+  auto program = incremental_parser.parse();
+  expect_same_as_from_scratch(incremental_parser, program, context + ", initial parse");
+  for (const TextEdit& applied : {edit, undo_edit(text, edit)}) {
+    std::string edit_context = fmt::format("{}: {} characters at {} replaced with '{}'", context,
+                                           applied.removed_length, applied.offset, applied.inserted_text);
+    program = incremental_parser.apply(applied);
+    expect_same_as_from_scratch(incremental_parser, program, edit_context);
+    expect(&applied != &edit || incremental_parser.last_change() == expected_change, "unexpected change",
+           edit_context);
+  }
+}
+
+constexpr const char* kProcedures = R"(
+PROGRAM Procedures;
+VAR x : INTEGER;
+PROCEDURE A(a : INTEGER);
+BEGIN
+  { Comment in A. }
+  x := a
+END;
+PROCEDURE B(b : INTEGER; c : REAL);
+VAR y : INTEGER;
+BEGIN
+  y := b;
+  x := y
+END;
+BEGIN
+  A(1);
+  B(2, 3.0)
+END.
+)";
+
+// Edits that the random ones rarely make.
+void apply_targeted_edits() {
+  std::string text{kProcedures};
+  auto offset = [&text](std::string_view needle) { return static_cast<int>(text.find(needle)); };
+  auto length = [](std::string_view removed) { return static_cast<int>(removed.size()); };
+  struct TargetedEdit {
+    const char* description;
+    TextEdit edit;
+    ProgramChange expected_change;
+  };
+  TargetedEdit edits[] = {
+      {"inside a comment", {offset("in A"), length("in A"), "inside A"}, ProgramChange::NONE},
+      {"whitespace between tokens", {offset(":= a"), 0, "  "}, ProgramChange::NONE},
+      {"statement", {offset("x := a"), length("x := a"), "x := a * 2"}, ProgramChange::PROCEDURE},
+      {"procedure name", {offset("A(a"), 1, "C"}, ProgramChange::WHOLE_PROGRAM},
+      {"parameter list", {offset("; c : REAL"), length("; c : REAL"), ""}, ProgramChange::WHOLE_PROGRAM},
+      {"parameter type", {offset("REAL)"), length("REAL"), "INTEGER"}, ProgramChange::WHOLE_PROGRAM},
+      {"span of two procedures", {offset("x := a"), length("x := a\nEND;\nPROCEDURE B"), "x := a\nEND;\nPROCEDURE D"},
+       ProgramChange::WHOLE_PROGRAM},
+      {"comment that ends the procedure early", {offset("{ Comment"), 0, "x := a END; {"},
+       ProgramChange::WHOLE_PROGRAM},
+      {"unterminated comment", {offset("y := b"), 0, "{"}, ProgramChange::WHOLE_PROGRAM},
+  };
+  for (const auto& [description, edit, expected_change] : edits) {
+    apply_and_undo(text, edit, expected_change, fmt::format("Procedures, {}", description));
+  }
+}
+
+}
+
+}
+
+int main() {
+  using namespace freezing::interpreter::test;
+
+  apply_targeted_edits();
+  for (uint32_t seed = 0; seed < 10; seed++) {
+    run_edits(seed);
+    edit_each_procedure(seed);
+  }
+  return test_result();
+}
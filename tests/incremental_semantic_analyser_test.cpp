@@ -0,0 +1,269 @@
+// Checks that the IncrementalSemanticAnalyser finds the same errors, and resolves and types the nodes the same way, as
+// the analysis of the whole program does, after each edit of a sequence that the IncrementalParser applies.
+
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "edit_generator.h"
+#include "incremental_parser.h"
+#include "incremental_semantic_analyser.h"
+#include "program_generator.h"
+#include "semantic_analyser.h"
+#include "test_utils.h"
+
+namespace freezing::interpreter::test {
+
+namespace {
+
+constexpr int kNumEdits = 200;
+// Every so many edits, the text is replaced with the original one, which is analysed fully.
+constexpr int kResetInterval = 50;
+
+// Errors, in the order in which they are reported.
+std::string describe_errors(const std::vector<SemanticAnalysisError>& errors) {
+  std::string description{};
+  for (const auto& error : errors) {
+    description += error.message + "; ";
+  }
+  return description;
+}
+
+// Address and type of every variable reference, and the address and the target of every call, in the order in which
+// they are visited. Targets are the indices of the called procedures' declarations in the program, since the models
+// keep the headers in different symbol tables.
+std::string describe_tables(const Program& program, const SemanticModel& semantic_model) {
+  std::unordered_map<const LazyBlock*, int> declaration_indices;
+  AstVisitorCallbacks declaration_callbacks{};
+  declaration_callbacks.procedure_decl_pre = [&declaration_indices](const ProcedureDecl& procedure_decl) {
+    declaration_indices.emplace(procedure_decl.block, declaration_indices.size());
+  };
+  AstVisitorFn{declaration_callbacks}.visit(program);
+
+  std::stringstream tables{};
+  auto describe_type = [&semantic_model, &tables](const auto& node) {
+    tables << ":" << semantic_model.expression_types[node.id] << " ";
+  };
+  AstVisitorCallbacks callbacks{};
+  callbacks.variable = [&semantic_model, &tables](const Variable& variable) {
+    const auto& address = semantic_model.addresses[variable.id];
+    tables << variable.name << "@" << address.depth << ":" << address.slot << ":"
+           << semantic_model.expression_types[variable.id] << " ";
+  };
+  callbacks.procedure_call_post =
+      [&semantic_model, &declaration_indices, &tables](const ProcedureCall& procedure_call) {
+        const auto* target = semantic_model.call_targets[procedure_call.id];
+        tables << procedure_call.name << "@" << semantic_model.addresses[procedure_call.id].depth << "->";
+        if (target == nullptr) {
+          tables << "none ";
+        } else {
+          auto index_it = declaration_indices.find(target->block);
+          // Declaration of a replaced procedure.
+          tables << (index_it == declaration_indices.end() ? "stale" : std::to_string(index_it->second)) << " ";
+        }
+      };
+  callbacks.num = [&describe_type](const Num& num) { describe_type(num); };
+  callbacks.bin_op = [&describe_type](const BinOp& bin_op) { describe_type(bin_op); };
+  callbacks.unary_op = [&describe_type](const UnaryOp& unary_op) { describe_type(unary_op); };
+  AstVisitorFn{callbacks}.visit(program);
+  return tables.str();
+}
+
+void expect_same_as_full_analysis(const Program& program,
+                                  const IncrementalSemanticAnalyser& analyser,
+                                  const Result<const SemanticModel*, std::vector<SemanticAnalysisError>>& result,
+                                  const std::string& context) {
+  // Same as SemanticAnalyser::analyse(), but the model is kept when there are errors.
+  SemanticModel semantic_model{};
+  detail::reserve_node_ids(semantic_model, program.id);
+  detail::AnalysisState state{semantic_model, -1, {}};
+  AstVisitorFn{detail::make_analysis_callbacks(state)}.visit(program);
+
+  expect_eq(describe_errors(result ? std::vector<SemanticAnalysisError>{} : result.error()),
+            describe_errors(state.errors), "errors", context);
+  expect(!result || *result == &analyser.semantic_model(), "result is not the kept model", context);
+  expect_eq(describe_tables(program, analyser.semantic_model()), describe_tables(program, semantic_model), "tables",
+            context);
+}
+
+// Analyses the program that the parser returned for the last edit, and compares the analysis with a full one. Only the
+// re-parsed procedure is re-analysed, if there is one.
+ProgramChange analyse_edit(const IncrementalParser& incremental_parser,
+                           IncrementalSemanticAnalyser& analyser,
+                           const Program& program,
+                           const std::string& context) {
+  ProgramChange change = incremental_parser.last_change();
+  Result<const SemanticModel*, std::vector<SemanticAnalysisError>> result = nullptr;
+  switch (change) {
+    case ProgramChange::NONE:
+      result = analyser.reanalyse(program, {});
+      break;
+    case ProgramChange::PROCEDURE:
+      result = analyser.reanalyse(program, {incremental_parser.reparsed_procedure()});
+      break;
+    case ProgramChange::WHOLE_PROGRAM:
+      result = analyser.analyse(program);
+      break;
+  }
+  expect_same_as_full_analysis(program, analyser, result, context);
+  return change;
+}
+
+std::string describe_edit(const TextEdit& edit) {
+  return fmt::format("{} characters at {} replaced with '{}'", edit.removed_length, edit.offset, edit.inserted_text);
+}
+
+void run_edits(uint32_t seed) {
+  std::string original = ProgramGenerator{seed}.generate(3 + seed % 6);
+  IncrementalParser incremental_parser{0, original};
+  IncrementalSemanticAnalyser analyser{};
+  auto program = incremental_parser.parse();
+  expect(program.has_value(), "generated program doesn't parse", fmt::format("seed {}", seed));
+  if (program) {
+    analyse_edit(incremental_parser, analyser, **program, fmt::format("seed {}, initial analysis", seed));
+  }
+
+  EditGenerator edit_generator{seed};
+  int num_procedure_changes = 0;
+  for (int step = 1; step <= kNumEdits; step++) {
+    TextEdit edit = step % kResetInterval == 0
+                    ? TextEdit{0, static_cast<int>(incremental_parser.text().size()), original}
+                    : edit_generator.generate(incremental_parser.text(), incremental_parser.tokens());
+    // The parser keeps the program between the edits only if it parsed, and then it was analysed too.
+    program = incremental_parser.apply(edit);
+    if (program) {
+      std::string context = fmt::format("seed {}, edit {}: {}", seed, step, describe_edit(edit));
+      if (analyse_edit(incremental_parser, analyser, **program, context) == ProgramChange::PROCEDURE) {
+        num_procedure_changes++;
+      }
+    }
+  }
+  // Otherwise the test would only check the full analysis.
+  expect(num_procedure_changes > 0, "no procedure was re-analysed on its own", fmt::format("seed {}", seed));
+}
+
+// Applies the edit and then undoes it, each time comparing the analysis with a full one. Returns the number of times
+// that a procedure was re-analysed on its own.
+int apply_and_undo(const std::string& text, const TextEdit& edit, const std::string& context) {
+  IncrementalParser incremental_parser{0, text};
+  IncrementalSemanticAnalyser analyser{};
+  auto program = incremental_parser.parse();
+  if (!expect(program.has_value(), "program doesn't parse", context)) {
+    return 0;
+  }
+  analyse_edit(incremental_parser, analyser, **program, context + ", initial analysis");
+  int num_procedure_changes = 0;
+  for (const TextEdit& applied : {edit, undo_edit(text, edit)}) {
+    std::string edit_context = fmt::format("{}: {}", context, describe_edit(applied));
+    program = incremental_parser.apply(applied);
+    if (expect(program.has_value(), "edited program doesn't parse", edit_context)
+        && analyse_edit(incremental_parser, analyser, **program, edit_context) == ProgramChange::PROCEDURE) {
+      num_procedure_changes++;
+    }
+  }
+  return num_procedure_changes;
+}
+
+// Changes the header of each top level procedure, so that the calls in the later declarations resolve differently, or
+// fail to. The top level declarations must start at the beginning of a line.
+void edit_each_header(const std::string& text, const std::string& context) {
+  IncrementalParser incremental_parser{0, text};
+  auto program = incremental_parser.parse();
+  if (!expect(program.has_value(), "program doesn't parse", context)) {
+    return;
+  }
+  std::vector<std::string> names;
+  for (const auto& procedure_decl : (*program)->block.procedure_declarations) {
+    names.emplace_back(procedure_decl.name.text());
+  }
+
+  size_t pos = 0;
+  int num_procedure_changes = 0;
+  for (size_t i = 0; i < names.size(); i++) {
+    pos = text.find("\nPROCEDURE " + names[i] + "(", pos) + 1;
+    int name_begin = static_cast<int>(pos + std::string_view{"PROCEDURE "}.size());
+    int name_length = static_cast<int>(names[i].size());
+    int parameters_end = static_cast<int>(text.find(");", pos));
+    int first_type = static_cast<int>(text.find(" : ", pos) + 3);
+    bool is_integer = text.compare(first_type, 7, "INTEGER") == 0;
+    TextEdit edits[] = {
+        TextEdit{parameters_end, 0, "; z : REAL"},
+        TextEdit{first_type, is_integer ? 7 : 4, is_integer ? "REAL" : "INTEGER"},
+        TextEdit{name_begin, name_length, "Q"},
+        // Declared twice.
+        TextEdit{name_begin, name_length, names[(i + 1) % names.size()]},
+    };
+    for (const TextEdit& edit : edits) {
+      num_procedure_changes += apply_and_undo(text, edit, fmt::format("{}, procedure {}", context, names[i]));
+    }
+  }
+  // The parser parses the whole program once the replaced nodes outnumber the others, which a large procedure does.
+  expect(num_procedure_changes > 0, "no procedure was re-analysed on its own", context);
+}
+
+// Analyses without errors, so that the model is also returned as the result.
+constexpr const char* kCalls = R"(
+PROGRAM Calls;
+VAR
+  a : INTEGER;
+  r : REAL;
+PROCEDURE A(x : INTEGER; y : REAL);
+BEGIN
+  a := x;
+  r := y
+END;
+PROCEDURE B(x : INTEGER; y : INTEGER);
+VAR t : INTEGER;
+BEGIN
+  A(x, y);
+  t := x + y
+END;
+PROCEDURE C(x : REAL; y : INTEGER);
+BEGIN
+  B(y, y);
+  A(y, x)
+END;
+BEGIN
+  C(1.5, 2);
+  B(a, a)
+END.
+)";
+
+// Edits the body of a single procedure of kCalls, so that only it is re-analysed, both by the edit and its undo.
+void edit_bodies() {
+  std::string text{kCalls};
+  auto replace = [&text](std::string_view removed, std::string inserted) {
+    return TextEdit{static_cast<int>(text.find(removed)), static_cast<int>(removed.size()), std::move(inserted)};
+  };
+  std::pair<const char*, TextEdit> edits[] = {
+      {"local variable that shadows a global", replace("VAR t : INTEGER;", "VAR t : INTEGER; a : REAL;")},
+      {"assignment to a global", replace("t := x + y", "a := x + y")},
+      {"undeclared variable", replace("t := x + y", "t := x + w")},
+      {"call of a later procedure", replace("a := x;", "C(y, x);")},
+      {"call with the wrong number of arguments", replace("B(y, y);", "B(y);")},
+      {"nested procedure",
+       replace("BEGIN\n  B(y, y);", "PROCEDURE N(n : INTEGER);\nBEGIN\n  A(n, r)\nEND;\nBEGIN\n  N(y);")},
+  };
+  for (const auto& [description, edit] : edits) {
+    std::string context = fmt::format("Calls, {}", description);
+    expect(apply_and_undo(text, edit, context) == 2, "the procedure wasn't re-analysed on its own", context);
+  }
+}
+
+}
+
+}
+
+int main() {
+  using namespace freezing::interpreter::test;
+
+  edit_each_header(kCalls, "Calls");
+  edit_bodies();
+  for (uint32_t seed = 0; seed < 10; seed++) {
+    run_edits(seed);
+    edit_each_header(ProgramGenerator{seed}.generate(3 + seed % 6), fmt::format("seed {}", seed));
+  }
+  return test_result();
+}
@@ -0,0 +1,144 @@
+// Checks the results of small programs, which both execution modes must produce.
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "interpreter.h"
+#include "test_utils.h"
+#include "variant_ostream.h"
+
+namespace freezing::interpreter::test {
+
+namespace {
+
+// Frames in the order in which they are released, with the values of their variables. The main program's frame is the
+// last one.
+class FrameRecorder : public ExecutionObserver {
+public:
+  void on_return(const StackFrame& frame) override {
+    frames_ << frame;
+  }
+
+  std::string frames() const {
+    return frames_.str();
+  }
+
+private:
+  std::stringstream frames_;
+};
+
+// Released frames, or the errors of the program.
+std::string run(const std::string& text, ExecutionMode execution_mode) {
+  FrameRecorder recorder{};
+  auto result = Interpreter{execution_mode, &recorder}.run(std::string{text});
+  std::stringstream errors{};
+  if (!result) {
+    errors << "Failed: " << result.error();
+    return errors.str();
+  }
+  for (const auto& error : result->errors) {
+    errors << error << "; ";
+  }
+  return result->errors.empty() ? recorder.frames() : errors.str();
+}
+
+// Parses the block that the run left unparsed, which views the source that the returned state owns. The block has a
+// syntax error, whose message quotes the text.
+void expect_unparsed_block_error(const std::string& text, const std::string& expected, const std::string& context) {
+  auto result = Interpreter{ExecutionMode::TREE_WALKER, nullptr, ParsingMode::LAZY_PROCEDURE_BODIES}.run(
+      std::string{text});
+  if (!expect(result && result->program.has_value(), "program doesn't run", context)) {
+    return;
+  }
+  std::string errors;
+  for (const auto& procedure_decl : result->program->block.procedure_declarations) {
+    if (procedure_decl.block->parsed() == nullptr) {
+      auto block = procedure_decl.block->get();
+      errors += block ? "parsed; " : block.error().message() + "; ";
+    }
+  }
+  expect_eq(errors, expected, "errors of the unparsed blocks", context);
+}
+
+void expect_result(const std::string& text, const std::string& expected, const std::string& context) {
+  expect_eq(run(text, ExecutionMode::TREE_WALKER), expected, "tree walker result", context);
+  expect_eq(run(text, ExecutionMode::BYTECODE), expected, "bytecode result", context);
+}
+
+}
+
+}
+
+int main() {
+  using namespace freezing::interpreter::test;
+
+  expect_result(R"(
+PROGRAM Params;
+VAR r : REAL;
+PROCEDURE P(a : INTEGER; b : REAL);
+VAR c : REAL;
+BEGIN
+  c := a + b;
+  r := c
+END;
+BEGIN
+  P(1, 2)
+END.
+)",
+                "StackFrame(P)\n  a = 1\n  b = 2\n  c = 3\nStackFrame(Params)\n  r = 3\n",
+                "parameters");
+  // The second parameter would be bound to the slot of b.
+  expect_result(R"(
+PROGRAM DuplicateParams;
+PROCEDURE P(a, a : INTEGER);
+VAR b : INTEGER;
+BEGIN
+  b := a
+END;
+BEGIN
+  P(1, 2)
+END.
+)",
+                "Already defined symbols: [a]; ",
+                "duplicate parameters");
+  // '/' is the real division, even of two integers, while DIV truncates. Both are checked on constants, which are
+  // folded, and on variables.
+  expect_result(R"(
+PROGRAM Division;
+VAR
+  a, b, c : INTEGER;
+  x, y, z : REAL;
+BEGIN
+  a := 7 DIV 2;
+  x := 7 / 2;
+  b := 7;
+  c := -b DIV 2;
+  y := b / 2;
+  z := b DIV 2 / 2
+END.
+)",
+                "StackFrame(Division)\n  a = 3\n  b = 7\n  c = -3\n  x = 3.5\n  y = 3.5\n  z = 1.5\n",
+                "division");
+  expect_result("PROGRAM RealToInteger; VAR a : INTEGER; BEGIN a := 7 / 2 END.",
+                "Cannot assign REAL expression to INTEGER variable 'a'; ",
+                "real division into an integer");
+  expect_unparsed_block_error(R"(
+PROGRAM Lazy;
+VAR a : INTEGER;
+PROCEDURE Called(x : INTEGER);
+BEGIN
+  a := x
+END;
+PROCEDURE NeverCalled(x : INTEGER);
+VAR b : INTEGER;
+BEGIN
+  b := x x
+END;
+BEGIN
+  Called(1)
+END.
+)",
+                              "Unexpected token found. Expected: END. Actual: Token(ID, lexeme=x).; ",
+                              "lazy blocks after the run");
+  return test_result();
+}
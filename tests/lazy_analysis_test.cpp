@@ -0,0 +1,243 @@
+// Checks that the blocks that are parsed lazily and analysed by analyse_block() resolve their names exactly as the
+// analysis of the eagerly parsed program does.
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "parser.h"
+#include "program_generator.h"
+#include "semantic_analyser.h"
+#include "source_manager.h"
+#include "test_utils.h"
+
+namespace freezing::interpreter::test {
+
+namespace {
+
+// Results of the analysis in terms that don't depend on the node ids or the scope ids, which differ between the modes.
+struct AnalysisSummary {
+  bool is_parsed;
+  // Sorted, since the lazily parsed blocks are analysed after the rest of the program.
+  std::vector<std::string> errors{};
+  // Depth and the index of the called procedure's declaration, in the order in which the calls are visited.
+  std::string call_targets{};
+  // Depth and slot of every variable reference, in the order in which they are visited.
+  std::string addresses{};
+};
+
+void analyse_lazy_blocks(SemanticModel& semantic_model, const std::vector<ProcedureDecl>& procedure_declarations,
+                         std::vector<SemanticAnalysisError>& errors) {
+  for (const auto& procedure_decl : procedure_declarations) {
+    auto block = procedure_decl.block->get();
+    if (!block) {
+      errors.push_back(SemanticAnalysisError{"Block doesn't parse"});
+      continue;
+    }
+    if (semantic_model.unanalysed_blocks.count(procedure_decl.block) > 0) {
+      auto analysed = SemanticAnalyser{}.analyse_block(semantic_model, *procedure_decl.block);
+      if (!analysed) {
+        errors.insert(errors.end(), analysed.error().begin(), analysed.error().end());
+      }
+    }
+    analyse_lazy_blocks(semantic_model, (*block)->procedure_declarations, errors);
+  }
+}
+
+AnalysisSummary analyse(const std::string& text, bool lazy_procedure_bodies) {
+  SourceManager source_manager{};
+  SourceId source_id = source_manager.add_buffer("generated.pas", std::string{text});
+  ParserOptions options{};
+  options.lazy_procedure_bodies = lazy_procedure_bodies;
+  auto parser = Parser::create(source_manager, source_id, options);
+  if (!parser) {
+    return AnalysisSummary{false};
+  }
+  auto program = parser->parse_program();
+  if (!program) {
+    return AnalysisSummary{false};
+  }
+
+  // Same as SemanticAnalyser::analyse(), but the model is kept when there are errors.
+  SemanticModel semantic_model{};
+  detail::reserve_node_ids(semantic_model, program->id);
+  detail::AnalysisState state{semantic_model, -1, {}};
+  AstVisitorFn{detail::make_analysis_callbacks(state)}.visit(*program);
+  auto errors = std::move(state.errors);
+  analyse_lazy_blocks(semantic_model, program->block.procedure_declarations, errors);
+
+  AnalysisSummary summary{true};
+  for (const auto& error : errors) {
+    summary.errors.push_back(error.message);
+  }
+  std::sort(summary.errors.begin(), summary.errors.end());
+
+  // All the blocks are parsed by now, so the visitor reaches every node.
+  std::unordered_map<const LazyBlock*, int> declaration_indices;
+  AstVisitorCallbacks declaration_callbacks{};
+  declaration_callbacks.procedure_decl_pre = [&declaration_indices](const ProcedureDecl& procedure_decl) {
+    declaration_indices.emplace(procedure_decl.block, declaration_indices.size());
+  };
+  AstVisitorFn{declaration_callbacks}.visit(*program);
+
+  std::stringstream call_targets{};
+  std::stringstream addresses{};
+  AstVisitorCallbacks callbacks{};
+  callbacks.procedure_call_post =
+      [&semantic_model, &declaration_indices, &call_targets](const ProcedureCall& procedure_call) {
+        const auto* target = semantic_model.call_targets[procedure_call.id];
+        call_targets << procedure_call.name << "@" << semantic_model.addresses[procedure_call.id].depth << "->"
+                     << (target == nullptr ? -1 : declaration_indices.at(target->block)) << " ";
+      };
+  callbacks.variable = [&semantic_model, &addresses](const Variable& variable) {
+    const auto& address = semantic_model.addresses[variable.id];
+    addresses << variable.name << "@" << address.depth << ":" << address.slot << " ";
+  };
+  AstVisitorFn{callbacks}.visit(*program);
+  summary.call_targets = call_targets.str();
+  summary.addresses = addresses.str();
+  return summary;
+}
+
+std::string join(const std::vector<std::string>& lines) {
+  std::string joined;
+  for (const auto& line : lines) {
+    joined += line + "; ";
+  }
+  return joined;
+}
+
+void expect_same_analysis(const std::string& text, const std::string& context) {
+  auto eager = analyse(text, false);
+  auto lazy = analyse(text, true);
+  expect(eager.is_parsed && lazy.is_parsed, "program doesn't parse", context);
+  expect_eq(join(lazy.errors), join(eager.errors), "errors", context);
+  expect_eq(lazy.call_targets, eager.call_targets, "call targets", context);
+  expect_eq(lazy.addresses, eager.addresses, "addresses", context);
+}
+
+// Procedure B is declared after the procedure that calls it, so the call is an error.
+constexpr const char* kForwardCall = R"(
+PROGRAM ForwardCall;
+VAR x : INTEGER;
+PROCEDURE A(a : INTEGER);
+BEGIN
+  B(a)
+END;
+PROCEDURE B(b : INTEGER);
+BEGIN
+  x := b
+END;
+BEGIN
+  A(1)
+END.
+)";
+
+// N calls the top level C, since the nested C is declared after N.
+constexpr const char* kShadowedLater = R"(
+PROGRAM ShadowedLater;
+VAR x : INTEGER;
+PROCEDURE C(c : INTEGER);
+BEGIN
+  x := 1
+END;
+PROCEDURE P(p : INTEGER);
+  PROCEDURE N(n : INTEGER);
+  BEGIN
+    C(n)
+  END;
+  PROCEDURE C(c : INTEGER);
+  BEGIN
+    x := 2
+  END;
+BEGIN
+  N(p)
+END;
+BEGIN
+  P(0)
+END.
+)";
+
+// M reads the parameter x of P, and N its own variable x, that shadows the parameter.
+constexpr const char* kShadowedVariable = R"(
+PROGRAM ShadowedVariable;
+VAR x, y : INTEGER;
+PROCEDURE P(x : INTEGER);
+  PROCEDURE N(n : INTEGER);
+  VAR x : INTEGER;
+  BEGIN
+    x := n;
+    y := x
+  END;
+  PROCEDURE M(m : INTEGER);
+  BEGIN
+    y := x + m
+  END;
+BEGIN
+  N(x);
+  M(x)
+END;
+BEGIN
+  P(1)
+END.
+)";
+
+// Calls from the nested blocks to the procedures that enclose them.
+constexpr const char* kRecursion = R"(
+PROGRAM Recursion;
+VAR x : INTEGER;
+PROCEDURE P(p : INTEGER);
+  PROCEDURE N(n : INTEGER);
+  BEGIN
+    P(n - 1);
+    N(n - 1)
+  END;
+BEGIN
+  x := p;
+  N(p)
+END;
+BEGIN
+  P(1)
+END.
+)";
+
+// The errors are only in a nested block, which is analysed after the block that contains it.
+constexpr const char* kNestedErrors = R"(
+PROGRAM NestedErrors;
+VAR x : INTEGER;
+PROCEDURE P(p : INTEGER);
+  PROCEDURE N(n : INTEGER);
+  VAR n : REAL;
+  BEGIN
+    x := y;
+    Missing(n)
+  END;
+BEGIN
+  N(p)
+END;
+BEGIN
+  P(1)
+END.
+)";
+
+}
+
+}
+
+int main() {
+  using namespace freezing::interpreter::test;
+
+  expect_same_analysis(kForwardCall, "ForwardCall");
+  expect_same_analysis(kShadowedLater, "ShadowedLater");
+  expect(!analyse(kForwardCall, true).errors.empty(), "forward call is not an error", "ForwardCall");
+  expect_same_analysis(kShadowedVariable, "ShadowedVariable");
+  expect_same_analysis(kRecursion, "Recursion");
+  expect_same_analysis(kNestedErrors, "NestedErrors");
+  expect(analyse(kNestedErrors, true).errors.size() == 3, "nested errors are not reported", "NestedErrors");
+
+  for (uint32_t seed = 0; seed < 200; seed++) {
+    expect_same_analysis(ProgramGenerator{seed}.generate(1 + seed % 8), "seed " + std::to_string(seed));
+  }
+  return test_result();
+}
@@ -0,0 +1,151 @@
+// Checks that lex_parallel() produces the same tokens and errors as the Lexer does for the whole text, however the text
+// is split into chunks.
+
+#include <string>
+#include <vector>
+#include "lexer.h"
+#include "parallel_lexer.h"
+#include "program_generator.h"
+#include "test_utils.h"
+
+namespace freezing::interpreter::test {
+
+namespace {
+
+constexpr int kNumChunks[] = {2, 3, 4, 7, 16};
+
+std::string describe_result(const LexerResult<std::vector<Token>>& result) {
+  if (result) {
+    return fmt::format("{} tokens", result->size());
+  }
+  const Diagnostic& diagnostic = result.error().diagnostic;
+  return fmt::format("error at offset={}: {}", diagnostic.offset, diagnostic.message());
+}
+
+void expect_same_lexing(const std::string& text, const std::string& context, bool is_error = false) {
+  auto expected = Lexer{text, 0}.lex_all();
+  expect(!expected == is_error, is_error ? "missing lexer error" : "unexpected lexer error", context);
+  for (int num_chunks : kNumChunks) {
+    std::string chunks_context = fmt::format("{}, {} chunks", context, num_chunks);
+    auto actual = lex_parallel(text, 0, num_chunks);
+    if (!expect_eq(describe_result(actual), describe_result(expected), "result", chunks_context) || !actual) {
+      continue;
+    }
+    expect_same_tokens(*actual, *expected, chunks_context);
+  }
+}
+
+// Every boundary starts a line outside of a comment.
+void expect_boundaries_outside_comments(const std::string& text, const std::string& context) {
+  std::vector<bool> in_comment(text.size() + 1, false);
+  bool is_open = false;
+  for (size_t i = 0; i < text.size(); i++) {
+    in_comment[i] = is_open;
+    is_open = text[i] == '{' || (is_open && text[i] != '}');
+  }
+  for (int num_chunks : kNumChunks) {
+    for (int boundary : find_chunk_boundaries(text, num_chunks)) {
+      if (boundary > 0) {
+        expect(text[boundary - 1] == '\n' && !in_comment[boundary], "boundary isn't at a line outside of a comment",
+               fmt::format("{}, {} chunks, boundary {}", context, num_chunks, boundary));
+      }
+    }
+  }
+}
+
+// Splits a small text in two at the middle, which falls on the given line, and returns the boundary.
+int split_in_two(const std::string& text, std::string_view middle_line, const std::string& context) {
+  int middle = static_cast<int>(text.size() / 2);
+  int line_begin = static_cast<int>(text.find(middle_line));
+  expect(line_begin <= middle && middle < line_begin + static_cast<int>(middle_line.size()),
+         "middle of the text isn't on the line", context);
+  std::vector<int> boundaries = find_chunk_boundaries(text, 2);
+  return boundaries.size() == 2 ? boundaries[1] : -1;
+}
+
+// Chunks are split at fixed targets, so each text puts a target at a chosen place.
+void check_targeted_splits() {
+  // Middle of the text is in a comment, whose lines would fail to lex as code. The chunk starts after the comment.
+  std::string in_comment = "PROGRAM P;\nBEGIN\n{ a := $ 'unterminated\n  b := 1 _ {\n  $$ still comment\n}\n"
+                           "a := 1\nEND.\n";
+  expect_eq(split_in_two(in_comment, "  b := 1 _ {\n", "split in a comment"),
+            static_cast<int>(in_comment.find("a := 1")), "boundary", "split in a comment");
+  expect_same_lexing(in_comment, "split in a comment");
+
+  // Middle of the text is on a line that ends by opening a comment, so the chunk can't start on the next line.
+  std::string opens_comment = "PROGRAM P;\nVAR a : INTEGER;\nBEGIN a := 1 {\n$\n}\na := 2\nEND.\n";
+  expect_eq(split_in_two(opens_comment, "BEGIN a := 1 {\n", "split before a comment"),
+            static_cast<int>(opens_comment.find("a := 2")), "boundary", "split before a comment");
+  expect_same_lexing(opens_comment, "split before a comment");
+
+  // Middle of the text is right before a line that starts with a comment, which the chunk starts with.
+  std::string starts_comment = "PROGRAM P;\nBEGIN\n  a := 1\n{ $ }\na := 22222222\nEND.\n";
+  expect_eq(split_in_two(starts_comment, "  a := 1\n", "split before a comment line"),
+            static_cast<int>(starts_comment.find("{ $ }")), "boundary", "split before a comment line");
+  expect_same_lexing(starts_comment, "split before a comment line");
+
+  // The only error is in the last chunk, after a valid comment that crosses the previous boundary.
+  std::string last_chunk_error = "PROGRAM P;\nBEGIN\n{\n\n\n\n}\n  a := 1;\n  b := 2;\n  c := 3 $ 4\nEND.\n";
+  expect_same_lexing(last_chunk_error, "error in the last chunk", true);
+
+  for (const auto* text : {&in_comment, &opens_comment, &starts_comment, &last_chunk_error}) {
+    expect_boundaries_outside_comments(*text, "targeted split");
+  }
+}
+
+// Surrounds the lines of the program with comments that span several lines, so that many of the split targets fall
+// into a comment, some of them right before its end or after a '{' in it.
+std::string add_comments(const std::string& text, int seed) {
+  std::string commented{};
+  size_t line_start = 0;
+  for (int line = 0; line_start < text.size(); line++) {
+    size_t line_end = text.find('\n', line_start);
+    line_end = line_end == std::string::npos ? text.size() : line_end + 1;
+    commented.append(text, line_start, line_end - line_start);
+    line_start = line_end;
+    if ((line + seed) % 3 == 0) {
+      commented += "{ comment\n  that { spans\n\n  a few lines }\n";
+    } else if ((line + seed) % 5 == 0) {
+      commented += "  x := 1 { trailing comment } ;\n";
+    }
+  }
+  return commented;
+}
+
+}
+
+}
+
+int main() {
+  using namespace freezing::interpreter::test;
+
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    std::string program = ProgramGenerator{seed}.generate(20);
+    std::string context = "seed " + std::to_string(seed);
+    expect_same_lexing(program, context);
+    std::string commented = add_comments(program, seed);
+    expect_same_lexing(commented, context + " with comments");
+
+    // Errors in the later chunks, the first one is reported. They are inserted before the comments are added, so they
+    // aren't commented out.
+    size_t middle = program.find('\n', program.size() / 2);
+    size_t late = program.find('\n', program.size() * 3 / 4);
+    std::string late_error = program.substr(0, late) + " $ " + program.substr(late);
+    expect_same_lexing(add_comments(late_error, seed), context + " with a late error", true);
+    std::string two_errors = program.substr(0, middle) + " _ " + program.substr(middle, late - middle) + " $ "
+        + program.substr(late);
+    expect_same_lexing(add_comments(two_errors, seed), context + " with two errors", true);
+    expect_boundaries_outside_comments(add_comments(program, seed), context + " with comments");
+    // Comment that never ends runs to the end of the text, over all the later split targets.
+    expect_same_lexing(program.substr(0, middle) + "{ unterminated\n" + program.substr(middle),
+                       context + " with an unterminated comment");
+  }
+
+  check_targeted_splits();
+
+  // Text that is mostly one comment, and text without a new line at the end.
+  expect_same_lexing("BEGIN\n{" + std::string(4096, '\n') + "}\nEND.\n", "long comment");
+  expect_same_lexing("PROGRAM P;\nBEGIN\nEND.", "no new line at the end");
+  expect_same_lexing("", "empty text");
+  return test_result();
+}
@@ -0,0 +1,111 @@
+// Checks that the top level procedure declarations parsed in parallel produce the same AST, including the node ids, and
+// the same errors as the sequential parser.
+
+#include <string>
+#include "ast_dot_visualiser.h"
+#include "parser.h"
+#include "program_generator.h"
+#include "source_manager.h"
+#include "test_utils.h"
+
+namespace freezing::interpreter::test {
+
+namespace {
+
+// Enough declarations for every thread to get a share, see kMinProcedureDeclarationsPerThread.
+constexpr int kNumProcedures = 150;
+// Same as kMinProcedureDeclarationsPerThread.
+constexpr int kMinProceduresPerThread = 16;
+constexpr int kMaxNumThreads[] = {2, 4, 7};
+
+// DOT graph of the program, which includes the node ids, or the error.
+std::string parse(const std::string& text, int max_num_threads) {
+  SourceManager source_manager{};
+  SourceId source_id = source_manager.add_buffer("generated.pas", std::string{text});
+  ParserOptions options{};
+  options.max_num_threads = max_num_threads;
+  auto parser = Parser::create(source_manager, source_id, options);
+  if (!parser) {
+    return parser.error().diagnostic.message();
+  }
+  auto program = parser->parse_program();
+  if (!program) {
+    return std::visit([](const auto& error) {
+      return fmt::format("{} at offset {}", error.diagnostic.message(), error.diagnostic.offset);
+    }, parser->error(program.error()));
+  }
+  return AstDotVisualiser{}.generate(*program);
+}
+
+void expect_same_ast(const std::string& text, const std::string& context, bool is_error = false) {
+  std::string expected = parse(text, 1);
+  expect((expected.rfind("digraph", 0) != 0) == is_error, is_error ? "missing error" : "unexpected error", context);
+  for (int max_num_threads : kMaxNumThreads) {
+    expect_eq(parse(text, max_num_threads), expected, "AST", fmt::format("{}, {} threads", context, max_num_threads));
+  }
+}
+
+// Inserts the text after the first statement that follows the position.
+std::string insert_after_statement(const std::string& text, size_t pos, const std::string& inserted) {
+  size_t statement_end = text.find(";\n", pos);
+  return text.substr(0, statement_end + 1) + inserted + text.substr(statement_end + 1);
+}
+
+// Inserts the text after the first statement of the top level procedure P<index>.
+std::string break_declaration(const std::string& text, int index, const std::string& inserted) {
+  return insert_after_statement(text, text.find(fmt::format("\nPROCEDURE P{}(", index)), inserted);
+}
+
+// Declarations are split evenly between the threads, at least kMinProceduresPerThread each, so the numbers of
+// declarations around the multiples of it change the number of threads, and the errors next to the split points fall
+// into different shares.
+void check_split_points() {
+  for (int num_procedures : {1, kMinProceduresPerThread * 2 - 1, kMinProceduresPerThread * 2,
+                             kMinProceduresPerThread * 2 + 1, kMinProceduresPerThread * 3,
+                             kMinProceduresPerThread * 7, kMinProceduresPerThread * 7 + 1}) {
+    std::string program = ProgramGenerator{static_cast<uint32_t>(num_procedures)}.generate(num_procedures);
+    expect_same_ast(program, fmt::format("{} procedures", num_procedures));
+  }
+
+  // Two shares of 16 declarations, P0 to P15 and P16 to P31.
+  std::string program = ProgramGenerator{1}.generate(kMinProceduresPerThread * 2);
+  for (int index : {kMinProceduresPerThread - 1, kMinProceduresPerThread, kMinProceduresPerThread * 2 - 1}) {
+    std::string context = fmt::format("error in P{}", index);
+    expect_same_ast(break_declaration(program, index, " ) "), context, true);
+    expect_same_ast(break_declaration(program, index, " BEGIN "), context + " with unbalanced BEGIN", true);
+    expect_same_ast(break_declaration(program, index, " END; "), context + " with an early END", true);
+  }
+  // Errors on both sides of the split point, the one in the first share is reported.
+  std::string two_errors = break_declaration(program, kMinProceduresPerThread, " ( ");
+  expect_same_ast(break_declaration(two_errors, kMinProceduresPerThread - 1, " ) "), "errors in P15 and P16", true);
+}
+
+}
+
+}
+
+int main() {
+  using namespace freezing::interpreter::test;
+
+  check_split_points();
+
+  for (uint32_t seed = 0; seed < 100; seed++) {
+    std::string program = ProgramGenerator{seed}.generate(kNumProcedures - seed % 20);
+    std::string context = "seed " + std::to_string(seed);
+    expect_same_ast(program, context);
+  }
+
+  for (uint32_t seed = 0; seed < 10; seed++) {
+    std::string program = ProgramGenerator{seed}.generate(kNumProcedures);
+    std::string context = "seed " + std::to_string(seed);
+    // An error that keeps BEGIN and END balanced is found while the declarations are parsed in parallel, and one that
+    // doesn't fools the pre-scan of the declarations.
+    expect_same_ast(insert_after_statement(program, program.size() * 3 / 4, " ) "), context + " with a late error",
+                    true);
+    expect_same_ast(insert_after_statement(program, program.size() / 2, " BEGIN "), context + " with unbalanced BEGIN",
+                    true);
+    std::string two_errors = insert_after_statement(program, program.size() * 3 / 4, " ) ");
+    expect_same_ast(insert_after_statement(two_errors, program.size() / 3, " ( "), context + " with two errors", true);
+  }
+  return test_result();
+}
@@ -0,0 +1,155 @@
+#ifndef PASCAL_COMPILER_TUTORIAL_TESTS__PROGRAM_GENERATOR_H
+#define PASCAL_COMPILER_TUTORIAL_TESTS__PROGRAM_GENERATOR_H
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace freezing::interpreter::test {
+
+// Generates random programs that always parse, but whose names don't always resolve: statements reference undefined
+// variables, call procedures that are declared later or only in other scopes, nested procedures reuse the names of the
+// top level ones, and arguments don't always match the parameters. The same seed generates the same program.
+class ProgramGenerator {
+public:
+  explicit ProgramGenerator(uint32_t seed) : rng_{seed} {}
+
+  std::string generate(int num_procedures) {
+    text_.clear();
+    procedure_names_.clear();
+    for (int i = 0; i < num_procedures; i++) {
+      procedure_names_.push_back("P" + std::to_string(i));
+    }
+    text_ += "PROGRAM Generated;\nVAR\n  a, b : INTEGER;\n  r : REAL;\n";
+    for (int i = 0; i < num_procedures; i++) {
+      generate_procedure(procedure_names_[i], 1);
+    }
+    generate_compound_statement(0);
+    text_ += ".\n";
+    return text_;
+  }
+
+private:
+  static constexpr int kMaxDepth = 3;
+
+  std::mt19937 rng_;
+  std::string text_;
+  // Names of the top level procedures and of the nested ones generated so far.
+  std::vector<std::string> procedure_names_;
+
+  int random(int bound) {
+    return static_cast<int>(rng_() % bound);
+  }
+
+  void indent(int depth) {
+    text_.append(2 * depth, ' ');
+  }
+
+  const char* random_type() {
+    return random(2) == 0 ? "INTEGER" : "REAL";
+  }
+
+  void generate_procedure(std::string name, int depth) {
+    indent(depth - 1);
+    text_ += "PROCEDURE " + name + "(x : " + random_type() + "; y : " + random_type() + ");\n";
+    if (random(2) == 0) {
+      indent(depth - 1);
+      text_ += std::string{"VAR t : "} + random_type() + ";\n";
+    }
+    if (depth < kMaxDepth) {
+      int num_nested = random(3);
+      for (int i = 0; i < num_nested; i++) {
+        // Reusing a top level name shadows it, but only for the statements that follow the declaration.
+        std::string nested_name = random(3) == 0 ? procedure_names_[random(procedure_names_.size())]
+                                                 : name + "N" + std::to_string(i);
+        procedure_names_.push_back(nested_name);
+        generate_procedure(nested_name, depth + 1);
+      }
+    }
+    generate_compound_statement(depth - 1);
+    text_ += ";\n";
+  }
+
+  void generate_compound_statement(int depth) {
+    indent(depth);
+    text_ += "BEGIN\n";
+    int num_statements = 1 + random(4);
+    for (int i = 0; i < num_statements; i++) {
+      indent(depth + 1);
+      generate_statement(depth + 1);
+      text_ += i + 1 < num_statements ? ";\n" : "\n";
+    }
+    indent(depth);
+    text_ += "END";
+  }
+
+  void generate_statement(int depth) {
+    switch (random(6)) {
+      case 0:
+      case 1:
+        text_ += random_variable() + " := ";
+        generate_expression(2);
+        break;
+      case 2:
+      case 3: {
+        text_ += procedure_names_[random(procedure_names_.size())] + "(";
+        int num_arguments = random(8) == 0 ? 1 : 2;
+        for (int i = 0; i < num_arguments; i++) {
+          text_ += i > 0 ? ", " : "";
+          generate_expression(1);
+        }
+        text_ += ")";
+        break;
+      }
+      case 4:
+        if (depth < 8) {
+          text_ += "\n";
+          generate_compound_statement(depth);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  std::string random_variable() {
+    static const char* kVariables[] = {"a", "b", "r", "x", "y", "t", "u"};
+    return kVariables[random(std::size(kVariables))];
+  }
+
+  void generate_expression(int depth) {
+    int kind = depth == 0 ? random(3) : random(7);
+    switch (kind) {
+      case 0:
+        text_ += std::to_string(random(100));
+        break;
+      case 1:
+        text_ += std::to_string(random(100)) + "." + std::to_string(random(10));
+        break;
+      case 2:
+        text_ += random_variable();
+        break;
+      case 3:
+        text_ += random(2) == 0 ? "-" : "+";
+        generate_expression(depth - 1);
+        break;
+      case 4:
+        text_ += "(";
+        generate_expression(depth - 1);
+        text_ += ")";
+        break;
+      default: {
+        static const char* kOperators[] = {" + ", " - ", " * ", " / ", " DIV "};
+        generate_expression(depth - 1);
+        text_ += kOperators[random(std::size(kOperators))];
+        generate_expression(depth - 1);
+        break;
+      }
+    }
+  }
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL_TESTS__PROGRAM_GENERATOR_H
@@ -0,0 +1,85 @@
+#ifndef PASCAL_COMPILER_TUTORIAL_TESTS__TEST_UTILS_H
+#define PASCAL_COMPILER_TUTORIAL_TESTS__TEST_UTILS_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fmt/format.h>
+#include "token.h"
+
+namespace freezing::interpreter::test {
+
+// Number of checks that failed so far. Checks don't stop the test, so every mismatch is reported.
+inline int num_failures = 0;
+
+// Reports a failure with the context that identifies the input, e.g. the seed of a generated program.
+template<typename T>
+bool expect_eq(const T& actual, const T& expected, std::string_view what, std::string_view context) {
+  if (actual == expected) {
+    return true;
+  }
+  num_failures++;
+  std::cerr << "FAILED: " << what << " differs for " << context << "\n  expected: " << expected << "\n  actual:   "
+            << actual << std::endl;
+  return false;
+}
+
+inline bool expect(bool condition, std::string_view what, std::string_view context) {
+  if (condition) {
+    return true;
+  }
+  num_failures++;
+  std::cerr << "FAILED: " << what << " for " << context << std::endl;
+  return false;
+}
+
+// Type, location, span and value of the token.
+inline std::string describe(const Token& token) {
+  CharLocation location = token.location();
+  std::string description = fmt::format("{} at {}:{}, offset={}, length={}", token.token_type, location.line_number,
+                                        location.column_number, token.offset, token.length);
+  switch (token.token_type) {
+    case TokenType::INTEGER_CONST:
+      return description + fmt::format(", value={}", token.value.integer);
+    case TokenType::REAL_CONST:
+      return description + fmt::format(", value={}", token.value.real);
+    case TokenType::ID:
+      return description + fmt::format(", identifier={}", token.value.identifier);
+    default:
+      return description;
+  }
+}
+
+// Compares the tokens field by field, and describes only the first one that differs.
+inline bool expect_same_tokens(const std::vector<Token>& actual, const std::vector<Token>& expected,
+                               std::string_view context) {
+  for (size_t i = 0; i < actual.size() && i < expected.size(); i++) {
+    const Token& a = actual[i];
+    const Token& e = expected[i];
+    bool is_same = a.token_type == e.token_type && a.offset == e.offset && a.length == e.length
+        && a.location().line_number == e.location().line_number
+        && a.location().column_number == e.location().column_number;
+    if (is_same && (a.token_type == TokenType::INTEGER_CONST || a.token_type == TokenType::REAL_CONST
+        || a.token_type == TokenType::ID)) {
+      is_same = describe(a) == describe(e);
+    }
+    if (!is_same) {
+      return expect_eq(describe(a), describe(e), fmt::format("token {}", i), context);
+    }
+  }
+  return expect_eq(actual.size(), expected.size(), "number of tokens", context);
+}
+
+// Exit code of the test.
+inline int test_result() {
+  if (num_failures > 0) {
+    std::cerr << num_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL_TESTS__TEST_UTILS_H
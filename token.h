@@ -5,15 +5,19 @@
 #ifndef PASCAL_COMPILER_TUTORIAL_TOKEN_H
 #define PASCAL_COMPILER_TUTORIAL_TOKEN_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <fmt/format.h>
 #include <optional>
+#include <string_view>
+#include <type_traits>
 #include "optional_formatter.h"
 #include "stringstream_formatter.h"
 
 namespace freezing::interpreter {
 
-enum class TokenType {
+enum class TokenType : uint8_t {
   END_OF_FILE,
   INTEGER_CONST,
   REAL_CONST,
@@ -121,22 +125,70 @@ struct CharLocation {
   int column_number;
 };
 
+// CharLocation packed into 32 bits, the line number takes the upper 20 bits and the column number the lower 12.
+// Both saturate at their maximum, which only affects diagnostics of huge sources.
+class PackedCharLocation {
+public:
+  PackedCharLocation() = default;
+  explicit PackedCharLocation(CharLocation location)
+      : bits_{std::min<uint32_t>(location.line_number, kMaxLineNumber) << kColumnBits
+                  | std::min<uint32_t>(location.column_number, kMaxColumnNumber)} {}
+
+  CharLocation unpack() const {
+    return CharLocation{static_cast<int>(bits_ >> kColumnBits), static_cast<int>(bits_ & kMaxColumnNumber)};
+  }
+
+  // Moves the location by the number of lines, without unpacking it.
+  void add_lines(int line_delta) {
+    int line_number = std::clamp(static_cast<int>(bits_ >> kColumnBits) + line_delta, 0, int{kMaxLineNumber});
+    bits_ = static_cast<uint32_t>(line_number) << kColumnBits | (bits_ & kMaxColumnNumber);
+  }
+
+private:
+  static constexpr int kColumnBits = 12;
+  static constexpr uint32_t kMaxColumnNumber = (1u << kColumnBits) - 1;
+  static constexpr uint32_t kMaxLineNumber = (1u << (32 - kColumnBits)) - 1;
+
+  uint32_t bits_;
+};
+
+// Value of a numeric constant, decoded once by the lexer, or the interned name of an identifier.
+union TokenValue {
+  // INTEGER_CONST, always in the range of INTEGER.
+  int64_t integer;
+  // REAL_CONST.
+  double real;
+  // ID, the id of the Identifier.
+  uint32_t identifier;
+};
+
+// Tokens don't own their lexemes, they refer to the text they were lexed from, which must outlive them.
 struct Token {
-  // Location of the first character in the token.
-  CharLocation location;
   TokenType token_type;
-  std::optional<std::string> value;
+  // Location of the first character in the token.
+  PackedCharLocation packed_location;
+  // The lexeme is text[offset, offset + length).
+  uint32_t offset;
+  uint32_t length;
+  // Unspecified unless the token is a numeric constant or an identifier.
+  TokenValue value;
 
-  int AsInt() const {
-    assert(value.has_value());
-    return ::atoi(value->c_str());
+  CharLocation location() const {
+    return packed_location.unpack();
+  }
+
+  std::string_view lexeme(std::string_view text) const {
+    return text.substr(offset, length);
   }
 
   friend std::ostream& operator<<(std::ostream& os, const Token& token) {
-    return os << fmt::format("Token({}, lexeme={})", token.token_type, token.value);
+    return os << fmt::format("Token({}, offset={}, length={})", token.token_type, token.offset, token.length);
   }
 };
 
+static_assert(sizeof(Token) == 24, "Tokens are expected to be compact.");
+static_assert(std::is_trivially_copyable_v<Token>, "Tokens are expected to be plain records.");
+
 }
 
 template<>
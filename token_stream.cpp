@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cassert>
+#include "token_stream.h"
+
+namespace freezing::interpreter {
+
+TokenStream::TokenStream(std::vector<Token>&& tokens)
+    : owned_tokens_{std::move(tokens)}, tokens_{owned_tokens_.data()}, num_tokens_{static_cast<int>(owned_tokens_.size())},
+      next_token_index_{0}, buffer_{}, head_{0}, size_{0}, current_index_{0}, num_pulled_{0}, error_index_{0} {
+  assert(num_tokens_ > 0 && tokens_[num_tokens_ - 1].token_type == TokenType::END_OF_FILE);
+  push_back(pull());
+}
+
+TokenStream::TokenStream(const Token* tokens, int num_tokens, int index)
+    : tokens_{tokens}, num_tokens_{num_tokens}, next_token_index_{0}, buffer_{}, head_{0}, size_{0}, current_index_{0},
+      num_pulled_{0}, error_index_{0} {
+  assert(num_tokens_ > 0 && tokens_[num_tokens_ - 1].token_type == TokenType::END_OF_FILE);
+  seek(index);
+}
+
+TokenStream::TokenStream(std::string_view text, SourceId source_id)
+    : tokens_{nullptr}, num_tokens_{0}, next_token_index_{0}, lexer_{Lexer{text, source_id}}, buffer_{}, head_{0},
+      size_{0}, current_index_{0}, num_pulled_{0}, error_index_{0} {
+  push_back(pull());
+}
+
+const Token& TokenStream::current() const {
+  return buffer_[head_];
+}
+
+const Token& TokenStream::lookahead(int distance) {
+  assert(distance <= kMaxLookahead);
+  while (size_ <= distance) {
+    push_back(pull());
+  }
+  return buffer_[(head_ + distance) & (kCapacity - 1)];
+}
+
+void TokenStream::advance() {
+  head_ = (head_ + 1) & (kCapacity - 1);
+  size_--;
+  current_index_++;
+  if (size_ == 0) {
+    push_back(pull());
+  }
+}
+
+const Token* TokenStream::tokens() const {
+  assert(!lexer_);
+  return tokens_;
+}
+
+int TokenStream::num_tokens() const {
+  assert(!lexer_);
+  return num_tokens_;
+}
+
+int TokenStream::index() const {
+  assert(!lexer_);
+  // END_OF_FILE is repeated, but it's still the last token.
+  return std::min(current_index_, num_tokens_ - 1);
+}
+
+void TokenStream::seek(int index) {
+  assert(!lexer_ && index < num_tokens_);
+  next_token_index_ = index;
+  head_ = 0;
+  size_ = 0;
+  current_index_ = index;
+  num_pulled_ = index;
+  push_back(pull());
+}
+
+const LexerError* TokenStream::error() const {
+  if (error_ && current_index_ >= error_index_) {
+    return &*error_;
+  }
+  return nullptr;
+}
+
+Token TokenStream::pull() {
+  int index = num_pulled_++;
+  if (!lexer_) {
+    const Token& token = tokens_[next_token_index_];
+    if (next_token_index_ + 1 < num_tokens_) {
+      next_token_index_++;
+    }
+    return token;
+  }
+
+  if (!error_) {
+    auto result = lexer_->advance();
+    if (result) {
+      return lexer_->peek();
+    }
+    error_ = std::move(result).error();
+    error_index_ = index;
+  }
+  return Token{TokenType::END_OF_FILE, PackedCharLocation{lexer_->location()}, error_->diagnostic.offset, 0,
+               TokenValue{}};
+}
+
+void TokenStream::push_back(const Token& token) {
+  assert(size_ < kCapacity);
+  buffer_[(head_ + size_) & (kCapacity - 1)] = token;
+  size_++;
+}
+
+}
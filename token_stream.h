@@ -0,0 +1,79 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__TOKEN_STREAM_H
+#define PASCAL_COMPILER_TUTORIAL__TOKEN_STREAM_H
+
+#include <array>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "lexer.h"
+
+namespace freezing::interpreter {
+
+// Tokens consumed by the parser, one at a time, with a bounded lookahead.
+// Tokens come either from the tokens lexed in advance or, in the streaming mode, they're lexed on demand, in which
+// case only the current token and the lookahead are kept in memory.
+class TokenStream {
+public:
+  // Largest distance that can be looked ahead of the current token.
+  static constexpr int kMaxLookahead = 3;
+
+  // Streams the tokens lexed in advance. The last token must be END_OF_FILE.
+  explicit TokenStream(std::vector<Token>&& tokens);
+  // Streams tokens[index, num_tokens) without copying them, so the tokens must outlive the stream.
+  // The last token must be END_OF_FILE.
+  TokenStream(const Token* tokens, int num_tokens, int index);
+  // Lexes the tokens of the text on demand. The text isn't copied, so it must outlive the stream.
+  TokenStream(std::string_view text, SourceId source_id);
+  // The stream may point into the tokens it owns, so it's only moved.
+  TokenStream(const TokenStream&) = delete;
+  TokenStream& operator=(const TokenStream&) = delete;
+  TokenStream(TokenStream&&) = default;
+  TokenStream& operator=(TokenStream&&) = default;
+
+  const Token& current() const;
+  // Returns the token that is distance tokens after the current one.
+  const Token& lookahead(int distance);
+  // Moves to the next token. END_OF_FILE is repeated once it's reached.
+  void advance();
+
+  // Only available for the tokens lexed in advance, whose array is exposed so it can be scanned or split.
+  const Token* tokens() const;
+  int num_tokens() const;
+  // Index of the current token.
+  int index() const;
+  // Makes the token at the index the current one.
+  void seek(int index);
+
+  // Returns the lexer error if the current token couldn't be lexed. In that case the current token is END_OF_FILE,
+  // which is repeated from then on, and the error is expected to be reported instead of whatever the parser expected.
+  const LexerError* error() const;
+
+private:
+  static constexpr int kCapacity = 4;
+  static_assert(kMaxLookahead < kCapacity && (kCapacity & (kCapacity - 1)) == 0);
+
+  // Only one of them is used, depending on the mode. Tokens lexed in advance may be owned by the stream.
+  std::vector<Token> owned_tokens_;
+  const Token* tokens_;
+  int num_tokens_;
+  int next_token_index_;
+  std::optional<Lexer> lexer_;
+
+  // Ring buffer with the current token at head_, followed by the lookahead.
+  std::array<Token, kCapacity> buffer_;
+  int head_;
+  int size_;
+
+  // Tokens are numbered in the order they're pulled, so the error is reported only once the parser reaches it.
+  int current_index_;
+  int num_pulled_;
+  std::optional<LexerError> error_;
+  int error_index_;
+
+  Token pull();
+  void push_back(const Token& token);
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__TOKEN_STREAM_H
@@ -0,0 +1,52 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__VALUE_TYPE_H
+#define PASCAL_COMPILER_TUTORIAL__VALUE_TYPE_H
+
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <fmt/format.h>
+#include "token.h"
+#include "stringstream_formatter.h"
+
+namespace freezing::interpreter {
+
+// Static type of a variable or an expression.
+enum class ValueType : uint8_t {
+  INTEGER,
+  REAL,
+};
+
+// Type specification is either INTEGER or REAL, which is guaranteed by the parser.
+inline ValueType value_type_of(TokenType type_specification) {
+  assert(type_specification == TokenType::INTEGER || type_specification == TokenType::REAL);
+  return type_specification == TokenType::INTEGER ? ValueType::INTEGER : ValueType::REAL;
+}
+
+// INTEGER is promoted to REAL whenever it's mixed with REAL.
+inline ValueType common_type(ValueType lhs, ValueType rhs) {
+  return lhs == ValueType::INTEGER && rhs == ValueType::INTEGER ? ValueType::INTEGER : ValueType::REAL;
+}
+
+// Returns whether the value of type from can be stored into a variable of type to.
+inline bool is_assignable(ValueType to, ValueType from) {
+  return to == ValueType::REAL || from == ValueType::INTEGER;
+}
+
+inline std::ostream& operator<<(std::ostream& os, const ValueType& value_type) {
+  switch (value_type) {
+  case ValueType::INTEGER:
+    return os << "INTEGER";
+  case ValueType::REAL:
+    return os << "REAL";
+  }
+  return os << "UNKNOWN";
+}
+
+}
+
+template<>
+struct fmt::formatter<freezing::interpreter::ValueType>
+    : freezing::interpreter::StringStreamFormatter<freezing::interpreter::ValueType> {
+};
+
+#endif //PASCAL_COMPILER_TUTORIAL__VALUE_TYPE_H
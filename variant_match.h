@@ -12,12 +12,11 @@ template<class... Ts> struct overload : Ts... { using Ts::operator()...; };
 template<class... Ts> overload(Ts...) -> overload<Ts...>;
 
 template<typename T, typename...Args>
-std::optional<T> variant_try_get(const std::variant<Args...>& v) noexcept {
-  try {
-    return std::get<T>(v);
-  } catch (const std::bad_variant_access& e) {
-    return {};
+std::optional<T> variant_try_get(const std::variant<Args...>& v) {
+  if (const T* value = std::get_if<T>(&v)) {
+    return *value;
   }
+  return {};
 }
 
 #endif //PASCAL_COMPILER_TUTORIAL__VARIANT_MATCH_H
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cassert>
+#include "virtual_machine.h"
+#include "arithmetic.h"
+
+namespace freezing::interpreter {
+
+VirtualMachine::VirtualMachine(ExecutionObserver* observer) : observer_{observer} {}
+
+InterpreterResult<Void> VirtualMachine::run(const BytecodeProgram& program) {
+  // The dispatch loop is instantiated separately for the unobserved case, so that it doesn't pay for the hooks.
+  if (observer_ != nullptr) {
+    return run<true>(program);
+  }
+  return run<false>(program);
+}
+
+template<bool kObserved>
+InterpreterResult<Void> VirtualMachine::run(const BytecodeProgram& program) {
+  int max_stack_depth = 0;
+  for (const auto& chunk : program.chunks) {
+    max_stack_depth = std::max(max_stack_depth, chunk.max_stack_depth);
+  }
+  operands_.resize(max_stack_depth);
+  frames_.clear();
+
+  push_frame<kObserved>(program.chunks[program.entry_chunk], nullptr, -1, operands_.data());
+  auto result = execute<kObserved>(program);
+  if (!result) {
+    // Procedure frames are released while the error propagates, the same way the tree-walker does it.
+    // The main frame is left as is.
+    while (frames_.size() > 1) {
+      pop_frame<kObserved>();
+    }
+  }
+  return result;
+}
+
+template<bool kObserved>
+InterpreterResult<Void> VirtualMachine::execute(const BytecodeProgram& program) {
+  // Hot state is cached in locals and only written back to frames_ on calls. The operand stack pointer points past
+  // the top value, and is never written back, since the stack is empty between the statements.
+  const Chunk* chunk = frames_.back().chunk;
+  const Instruction* ip = chunk->code.data();
+  std::optional<DataType>* locals = call_stack_.top().slots;
+  DataType* sp = operands_.data();
+
+  while (true) {
+    const Instruction& instruction = *ip++;
+    switch (instruction.op_code) {
+    case OpCode::PUSH_CONST:
+      *sp++ = chunk->constants[instruction.operand];
+      break;
+    case OpCode::LOAD: {
+      const auto& value = locals[instruction.operand];
+      if (!value) {
+        // SemanticAnalyser is responsible for ensuring that the variable is declared.
+        // However, it doesn't ensure that it is initialized.
+        return make_error(InterpreterError{
+            fmt::format("Cannot read uninitialized variable '{}' in scope '{}'",
+                        chunk->scope->slot_names()[instruction.operand],
+                        chunk->scope->name())});
+      }
+      *sp++ = *value;
+      break;
+    }
+    case OpCode::STORE:
+      locals[instruction.operand] = *--sp;
+      if constexpr (kObserved) {
+        observer_->on_assign(call_stack_.top(), instruction.operand, *locals[instruction.operand]);
+      }
+      break;
+    case OpCode::LOAD_NONLOCAL: {
+      const auto& frame = call_stack_[call_stack_.frame_index_at(instruction.depth)];
+      const auto& value = frame.slots[instruction.operand];
+      if (!value) {
+        const auto* scope = frame.scope;
+        return make_error(InterpreterError{
+            fmt::format("Cannot read uninitialized variable '{}' in scope '{}'",
+                        scope->slot_names()[instruction.operand],
+                        chunk->scope->name())});
+      }
+      *sp++ = *value;
+      break;
+    }
+    case OpCode::STORE_NONLOCAL: {
+      auto& frame = call_stack_[call_stack_.frame_index_at(instruction.depth)];
+      frame.slots[instruction.operand] = *--sp;
+      if constexpr (kObserved) {
+        observer_->on_assign(frame, instruction.operand, *frame.slots[instruction.operand]);
+      }
+      break;
+    }
+    case OpCode::ADD_INTEGER: {
+      int right = detail::as_integer(*--sp);
+      sp[-1] = detail::as_integer(sp[-1]) + right;
+      break;
+    }
+    case OpCode::ADD_REAL: {
+      double right = detail::as_real(*--sp);
+      sp[-1] = detail::as_real(sp[-1]) + right;
+      break;
+    }
+    case OpCode::SUBTRACT_INTEGER: {
+      int right = detail::as_integer(*--sp);
+      sp[-1] = detail::as_integer(sp[-1]) - right;
+      break;
+    }
+    case OpCode::SUBTRACT_REAL: {
+      double right = detail::as_real(*--sp);
+      sp[-1] = detail::as_real(sp[-1]) - right;
+      break;
+    }
+    case OpCode::MULTIPLY_INTEGER: {
+      int right = detail::as_integer(*--sp);
+      sp[-1] = detail::as_integer(sp[-1]) * right;
+      break;
+    }
+    case OpCode::MULTIPLY_REAL: {
+      double right = detail::as_real(*--sp);
+      sp[-1] = detail::as_real(sp[-1]) * right;
+      break;
+    }
+    case OpCode::DIVIDE_INTEGER: {
+      int right = detail::as_integer(*--sp);
+      auto result = detail::divide(detail::as_integer(sp[-1]), right);
+      if (!result) {
+        return make_error(detail::division_by_zero_error());
+      }
+      sp[-1] = *result;
+      break;
+    }
+    case OpCode::DIVIDE_REAL: {
+      double right = detail::as_real(*--sp);
+      auto result = detail::divide(detail::as_real(sp[-1]), right);
+      if (!result) {
+        return make_error(detail::division_by_zero_error());
+      }
+      sp[-1] = *result;
+      break;
+    }
+    case OpCode::NEGATE_INTEGER:
+      sp[-1] = -detail::as_integer(sp[-1]);
+      break;
+    case OpCode::NEGATE_REAL:
+      sp[-1] = -detail::as_real(sp[-1]);
+      break;
+    case OpCode::INTEGER_TO_REAL:
+      sp[-1] = static_cast<double>(detail::as_integer(sp[-1]));
+      break;
+    case OpCode::CALL: {
+      const Chunk& callee = program.chunks[instruction.operand];
+      sp -= callee.num_params;
+      push_frame<kObserved>(callee, ip, call_stack_.frame_index_at(instruction.depth), sp);
+      chunk = frames_.back().chunk;
+      ip = chunk->code.data();
+      locals = call_stack_.top().slots;
+      break;
+    }
+    case OpCode::RETURN: {
+      const Instruction* return_address = frames_.back().return_address;
+      pop_frame<kObserved>();
+      if (frames_.empty()) {
+        return {};
+      }
+      chunk = frames_.back().chunk;
+      ip = return_address;
+      locals = call_stack_.top().slots;
+      break;
+    }
+    }
+  }
+}
+
+template<bool kObserved>
+void VirtualMachine::push_frame(const Chunk& chunk,
+                                const Instruction* return_address,
+                                int static_link,
+                                const DataType* arguments) {
+  StackFrame frame = call_stack_.allocate(*chunk.scope, static_link);
+  for (int param_idx = 0; param_idx < chunk.num_params; param_idx++) {
+    frame.slots[param_idx] = arguments[param_idx];
+  }
+  call_stack_.push(frame);
+  frames_.push_back(CallFrame{&chunk, return_address});
+  if constexpr (kObserved) {
+    observer_->on_call(call_stack_.top());
+  }
+}
+
+template<bool kObserved>
+void VirtualMachine::pop_frame() {
+  if constexpr (kObserved) {
+    observer_->on_return(call_stack_.top());
+  }
+  call_stack_.pop();
+  frames_.pop_back();
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef PASCAL_COMPILER_TUTORIAL__VIRTUAL_MACHINE_H
+#define PASCAL_COMPILER_TUTORIAL__VIRTUAL_MACHINE_H
+
+#include <vector>
+#include "bytecode.h"
+#include "interpreter_error.h"
+#include "call_stack.h"
+#include "execution_observer.h"
+
+namespace freezing::interpreter {
+
+// Stack based virtual machine that executes the output of BytecodeCompiler.
+// Produces the same observable behaviour as the tree-walking mode of the Interpreter.
+class VirtualMachine {
+public:
+  // The observer is optional and must outlive the virtual machine.
+  explicit VirtualMachine(ExecutionObserver* observer = nullptr);
+
+  InterpreterResult<Void> run(const BytecodeProgram& program);
+
+private:
+  // Bytecode specific state of a frame on the call stack. Indexed the same as the call stack.
+  struct CallFrame {
+    const Chunk* chunk;
+    // Instruction to continue from once the callee returns.
+    const Instruction* return_address;
+  };
+
+  ExecutionObserver* observer_;
+  // Operand stack, sized for the deepest chunk before a run. Calls are statements, so the stack only holds the values
+  // of a single chunk at a time.
+  std::vector<DataType> operands_;
+  CallStack call_stack_;
+  std::vector<CallFrame> frames_;
+
+  template<bool kObserved>
+  InterpreterResult<Void> run(const BytecodeProgram& program);
+  template<bool kObserved>
+  InterpreterResult<Void> execute(const BytecodeProgram& program);
+  // Arguments are the first chunk.num_params values, in the order of their slots.
+  template<bool kObserved>
+  void push_frame(const Chunk& chunk, const Instruction* return_address, int static_link, const DataType* arguments);
+  template<bool kObserved>
+  void pop_frame();
+};
+
+}
+
+#endif //PASCAL_COMPILER_TUTORIAL__VIRTUAL_MACHINE_H